@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <twr-crt.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// twr_hashmap vs libc++ std::unordered_map, with integer and string keys.
+// Each run inserts n keys, looks each one up, looks up n keys that are not in the map, then erases half of the keys.
+// The lookups are in a different order than the inserts, so that std::unordered_map's nodes aren't visited in the
+// order they were allocated.
+// Results are printed as JSON.  Link with twr-simd.a (bench-hashmap.simd.wasm) to measure the SIMD group probing.
+
+static uint64_t start_ms;
+
+static void start() {
+   start_ms=twr_epoch_timems();
+}
+
+static unsigned long elapsed() {
+   return (unsigned long)(twr_epoch_timems()-start_ms);
+}
+
+struct times {
+   unsigned long insert, hit, miss, erase;
+   bool ok;
+};
+
+static void print(const char* name, const char* impl, int n, const times& t, bool last) {
+   printf("    {\"name\": \"%s\", \"impl\": \"%s\", \"n\": %d, \"insert_ms\": %lu, \"hit_ms\": %lu, \"miss_ms\": %lu, \"erase_ms\": %lu, \"ok\": %s}%s\n",
+      name, impl, n, t.insert, t.hit, t.miss, t.erase, t.ok?"true":"false", last?"":",");
+}
+
+/****************************************************************/
+
+// distinct keys, in a random looking order.  keys[n..2n) are not in keys[0..n)
+static std::vector<intptr_t> int_keys(int n) {
+   std::vector<intptr_t> keys(2*n);
+   for (int i=0; i<2*n; i++)
+      keys[i]=(intptr_t)((uint32_t)i*2654435761u>>1);
+   return keys;
+}
+
+// visits 0..n-1 in a scattered order (n is not a multiple of the stride)
+static int scatter(int i, int n) {
+   return (int)((uint64_t)i*7919%n);
+}
+
+static void bench_int(int n) {
+   const std::vector<intptr_t> keys=int_keys(n);
+   times t={0, 0, 0, 0, true};
+
+   twr_hashmap_t* map=twr_hashmap_create_int(NULL);
+   start();
+   for (int i=0; i<n; i++)
+      twr_hashmap_put_int(map, keys[i], (void*)(intptr_t)(i+1));
+   t.insert=elapsed();
+   start();
+   for (int i=0; i<n; i++)
+      if (twr_hashmap_get_int(map, keys[scatter(i, n)])!=(void*)(intptr_t)(scatter(i, n)+1)) t.ok=false;
+   t.hit=elapsed();
+   start();
+   for (int i=n; i<2*n; i++)
+      if (twr_hashmap_get_int(map, keys[i])!=NULL) t.ok=false;
+   t.miss=elapsed();
+   start();
+   for (int i=0; i<n; i+=2)
+      twr_hashmap_remove_int(map, keys[i]);
+   t.erase=elapsed();
+   if (twr_hashmap_count(map)!=(size_t)n/2) t.ok=false;
+   twr_hashmap_destroy(map);
+   print("int", "twr_hashmap", n, t, false);
+
+   t={0, 0, 0, 0, true};
+   std::unordered_map<intptr_t, intptr_t> umap;
+   start();
+   for (int i=0; i<n; i++)
+      umap[keys[i]]=i+1;
+   t.insert=elapsed();
+   start();
+   for (int i=0; i<n; i++) {
+      auto it=umap.find(keys[scatter(i, n)]);
+      if (it==umap.end() || it->second!=scatter(i, n)+1) t.ok=false;
+   }
+   t.hit=elapsed();
+   start();
+   for (int i=n; i<2*n; i++)
+      if (umap.find(keys[i])!=umap.end()) t.ok=false;
+   t.miss=elapsed();
+   start();
+   for (int i=0; i<n; i+=2)
+      umap.erase(keys[i]);
+   t.erase=elapsed();
+   if (umap.size()!=(size_t)n/2) t.ok=false;
+   print("int", "std::unordered_map", n, t, false);
+}
+
+static void bench_str(int n) {
+   std::vector<std::string> keys;
+   for (int i=0; i<2*n; i++)
+      keys.push_back("key " + std::to_string((uint32_t)i*2654435761u));
+   times t={0, 0, 0, 0, true};
+
+   twr_hashmap_t* map=twr_hashmap_create_str(NULL);
+   start();
+   for (int i=0; i<n; i++)
+      twr_hashmap_put_str(map, keys[i].c_str(), (void*)(intptr_t)(i+1));
+   t.insert=elapsed();
+   start();
+   for (int i=0; i<n; i++)
+      if (twr_hashmap_get_str(map, keys[scatter(i, n)].c_str())!=(void*)(intptr_t)(scatter(i, n)+1)) t.ok=false;
+   t.hit=elapsed();
+   start();
+   for (int i=n; i<2*n; i++)
+      if (twr_hashmap_get_str(map, keys[i].c_str())!=NULL) t.ok=false;
+   t.miss=elapsed();
+   start();
+   for (int i=0; i<n; i+=2)
+      twr_hashmap_remove_str(map, keys[i].c_str());
+   t.erase=elapsed();
+   if (twr_hashmap_count(map)!=(size_t)n/2) t.ok=false;
+   twr_hashmap_destroy(map);
+   print("string", "twr_hashmap", n, t, false);
+
+   t={0, 0, 0, 0, true};
+   std::unordered_map<std::string, intptr_t> umap;
+   start();
+   for (int i=0; i<n; i++)
+      umap[keys[i]]=i+1;
+   t.insert=elapsed();
+   start();
+   for (int i=0; i<n; i++) {
+      auto it=umap.find(keys[scatter(i, n)]);
+      if (it==umap.end() || it->second!=scatter(i, n)+1) t.ok=false;
+   }
+   t.hit=elapsed();
+   start();
+   for (int i=n; i<2*n; i++)
+      if (umap.find(keys[i])!=umap.end()) t.ok=false;
+   t.miss=elapsed();
+   start();
+   for (int i=0; i<n; i+=2)
+      umap.erase(keys[i]);
+   t.erase=elapsed();
+   if (umap.size()!=(size_t)n/2) t.ok=false;
+   print("string", "std::unordered_map", n, t, true);
+}
+
+extern "C" __attribute__((export_name("bench_hashmap")))
+void bench_hashmap() {
+   printf("{\"benchmark\": \"hashmap\", \"results\": [\n");
+   bench_int(200000);
+   bench_str(100000);
+   printf("]}\n");
+}
@@ -0,0 +1,53 @@
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "bench-malloc.h"
+
+// C++ container churn: containers that grow, rehash, and are destroyed, with strings that
+// are too long for the small string optimization, so that each one is a heap allocation
+
+static std::string make_name(int i) {
+   std::string s("a name long enough to need the heap ");
+   s+=std::to_string(i);
+   return s;
+}
+
+size_t bench_cxx_churn(int rounds) {
+   size_t ops=0;
+
+   for (int r=0; r<rounds; r++) {
+      std::vector<std::string> names;
+      std::map<int, std::string> by_id;
+      std::unordered_map<std::string, int> by_name;
+
+      for (int i=0; i<2000; i++) {
+         names.push_back(make_name(i));
+         by_id[i*7]=names.back();
+         by_name[names.back()]=i;
+         ops+=3;
+      }
+      if (r==0) bench_sample_heap();
+
+      // erase every other entry and refill, so that the nodes are reused out of order
+      for (int i=0; i<2000; i+=2) {
+         by_id.erase(i*7);
+         by_name.erase(names[i]);
+         ops+=2;
+      }
+      for (int i=0; i<2000; i+=2) {
+         by_id[i*7+1]=names[i];
+         ops++;
+      }
+
+      std::vector<std::vector<int>> rows;
+      for (int i=0; i<500; i++) {
+         rows.emplace_back();
+         for (int k=0; k<i%64; k++)
+            rows.back().push_back(k);
+         ops++;
+      }
+   }
+
+   return ops;
+}
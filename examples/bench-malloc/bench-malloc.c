@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bench-malloc.h"
+
+// malloc/free benchmark
+// each pattern is a common way applications use the heap.  The results are printed as JSON, with the
+// operations per second and the peak heap use of each pattern, so that runs can be compared to catch regressions.
+//
+// builds as a twr-wasm module (see Makefile and bench-node.mjs), or as a native executable that uses the
+// platform's malloc (see source/twr-gcc-unit-test/Makefile-bench), which is useful as a reference
+
+#ifdef __wasm__
+#include <twr-crt.h>
+#define ALLOCATOR_NAME "twr-wasm"
+
+static uint64_t bench_timems(void) {
+	return twr_epoch_timems();
+}
+
+static size_t heap_base;
+
+static void heap_begin(void) {
+	struct twr_heap_stats stats;
+	twr_heap_profile(false);
+	twr_heap_profile(true);   // restarts the peak at the current live bytes
+	twr_heap_stats(&stats);
+	heap_base=stats.live_bytes;
+}
+
+static size_t heap_peak(void) {
+	struct twr_heap_stats stats;
+	twr_heap_stats(&stats);
+	return stats.peak_live_bytes-heap_base;
+}
+
+void bench_sample_heap(void) {
+}
+
+#else
+#include <time.h>
+#include <malloc.h>
+#define ALLOCATOR_NAME "native"
+
+static uint64_t bench_timems(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec*1000+ts.tv_nsec/1000000;
+}
+
+static size_t heap_base, heap_max;
+
+static size_t heap_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__>2 || __GLIBC_MINOR__>=33)
+	return mallinfo2().uordblks;
+#else
+	return 0;
+#endif
+}
+
+static void heap_begin(void) {
+	heap_base=heap_max=heap_in_use();
+}
+
+static size_t heap_peak(void) {
+	return heap_max-heap_base;
+}
+
+void bench_sample_heap(void) {
+	const size_t in_use=heap_in_use();
+	if (in_use>heap_max) heap_max=in_use;
+}
+
+#endif
+
+/****************************************************************/
+
+static uint32_t seed;
+static uint32_t next_rand(void) {
+	seed=seed*1103515245+12345;
+	return seed>>8;
+}
+
+// mostly small allocations, with an occasional medium or large allocation
+static size_t random_size(void) {
+	const uint32_t r=next_rand();
+	if ((r&0xF)<12) return (r>>4)%128+1;
+	else if ((r&0xF)<15) return (r>>4)%4096+1;
+	else return (r>>4)%65536+1;
+}
+
+static size_t small_size(void) {
+	return next_rand()%241+16;
+}
+
+static int failed;
+
+static void* checked_malloc(size_t size) {
+	void* p=malloc(size);
+	if (p==NULL) failed++;
+	return p;
+}
+
+/****************************************************************/
+
+#define NUM_SLOTS 4096
+static void* slot[NUM_SLOTS];
+
+// allocate a batch, then free it in the reverse order (stack like use, such as a recursive parser)
+static size_t lifo(void) {
+	const int batch=1000, rounds=200;
+	for (int r=0; r<rounds; r++) {
+		for (int i=0; i<batch; i++)
+			slot[i]=checked_malloc(small_size());
+		if (r==0) bench_sample_heap();
+		for (int i=batch-1; i>=0; i--)
+			free(slot[i]);
+	}
+	return (size_t)rounds*batch*2;
+}
+
+// a queue of live allocations: each step allocates a new block and frees the oldest (message or event queues)
+static size_t fifo(void) {
+	const int window=1000, steps=200000;
+	int head=0;
+	for (int i=0; i<window; i++)
+		slot[i]=checked_malloc(small_size());
+	bench_sample_heap();
+	for (int i=0; i<steps; i++) {
+		free(slot[head]);
+		slot[head]=checked_malloc(small_size());
+		if (++head==window) head=0;
+	}
+	for (int i=0; i<window; i++)
+		free(slot[i]);
+	return (size_t)steps*2+window*2;
+}
+
+// allocates and frees a random mix of sizes, keeping a working set of live allocations,
+// so that the heap fragments the way a long running application's heap does
+static size_t random_mix(int num_slots) {
+	const int num_ops=200000;
+	for (int i=0; i<num_slots; i++)
+		slot[i]=NULL;
+
+	for (int op=0; op<num_ops; op++) {
+		const int i=next_rand()%num_slots;
+		if (slot[i]) {
+			free(slot[i]);
+			slot[i]=NULL;
+		}
+		else {
+			slot[i]=checked_malloc(random_size());
+		}
+		if ((op&1023)==0) bench_sample_heap();
+	}
+
+	for (int i=0; i<num_slots; i++)
+		free(slot[i]);
+	return num_ops;
+}
+
+static size_t random_mix_256(void) {
+	return random_mix(256);
+}
+
+static size_t random_mix_4096(void) {
+	return random_mix(4096);
+}
+
+// buffers that grow a piece at a time with realloc (string builders, dynamic arrays, file reads)
+// several buffers grow together, so that a buffer usually can't grow in place
+static size_t realloc_growth(void) {
+	const int num_buffers=4, rounds=40;
+	const size_t max_size=256*1024;
+	size_t ops=0;
+	for (int r=0; r<rounds; r++) {
+		size_t size[4]={0};
+		for (int i=0; i<num_buffers; i++)
+			slot[i]=NULL;
+		while (size[num_buffers-1]<max_size) {
+			for (int i=0; i<num_buffers; i++) {
+				size[i]+=size[i]/8+64;
+				void* p=realloc(slot[i], size[i]);
+				if (p==NULL) {
+					failed++;
+					continue;
+				}
+				memset((char*)p+size[i]-64, i, 64);
+				slot[i]=p;
+				ops++;
+			}
+		}
+		if (r==0) bench_sample_heap();
+		for (int i=0; i<num_buffers; i++)
+			free(slot[i]);
+		ops+=num_buffers;
+	}
+	return ops;
+}
+
+static size_t cxx_churn(void) {
+	return bench_cxx_churn(20);
+}
+
+// each frame builds a list of small draw commands and a few strings, then frees them all at the end of the frame
+// (the pattern draw2d uses for a draw sequence)
+struct draw_cmd {
+	struct draw_cmd* next;
+	int type;
+	double x, y, w, h;
+	char* text;
+};
+
+static size_t draw2d_burst(void) {
+	const int frames=500, cmds_per_frame=400;
+	static const char* labels[]={"score", "level 12", "game over", "press any key to continue"};
+	size_t ops=0;
+	for (int f=0; f<frames; f++) {
+		struct draw_cmd* first=NULL;
+		for (int i=0; i<cmds_per_frame; i++) {
+			struct draw_cmd* cmd=checked_malloc(sizeof(struct draw_cmd));
+			if (cmd==NULL) continue;
+			cmd->type=i;
+			cmd->x=cmd->y=cmd->w=cmd->h=0;
+			cmd->text=NULL;
+			if ((i&15)==0) {
+				const char* label=labels[(i>>4)&3];
+				cmd->text=checked_malloc(strlen(label)+1);
+				if (cmd->text) strcpy(cmd->text, label);
+				ops++;
+			}
+			cmd->next=first;
+			first=cmd;
+			ops++;
+		}
+		if (f==0) bench_sample_heap();
+		while (first) {
+			struct draw_cmd* next=first->next;
+			free(first->text);
+			free(first);
+			first=next;
+		}
+	}
+	return ops*2;
+}
+
+/****************************************************************/
+
+static void run(const char* name, size_t (*pattern)(void), bool last) {
+	seed=1;
+	failed=0;
+	heap_begin();
+	const uint64_t start=bench_timems();
+	const size_t ops=pattern();
+	uint64_t ms=bench_timems()-start;
+	if (ms==0) ms=1;
+	printf("    {\"name\": \"%s\", \"ops\": %lu, \"ms\": %lu, \"ops_per_sec\": %lu, \"peak_heap\": %lu, \"failed\": %d}%s\n",
+		name, (unsigned long)ops, (unsigned long)ms, (unsigned long)((uint64_t)ops*1000/ms), (unsigned long)heap_peak(), failed, last?"":",");
+}
+
+#ifdef __wasm__
+__attribute__((export_name("bench_malloc")))
+#endif
+void bench_malloc(void) {
+	printf("{\"benchmark\": \"malloc\", \"allocator\": \"%s\", \"results\": [\n", ALLOCATOR_NAME);
+	run("lifo", lifo, false);
+	run("fifo", fifo, false);
+	run("random_mix_256", random_mix_256, false);
+	run("random_mix_4096", random_mix_4096, false);
+	run("realloc_growth", realloc_growth, false);
+	run("cxx_churn", cxx_churn, false);
+	run("draw2d_burst", draw2d_burst, true);
+	printf("]}\n");
+}
+
+#ifndef __wasm__
+int main(void) {
+	bench_malloc();
+	return 0;
+}
+#endif
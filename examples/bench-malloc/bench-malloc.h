@@ -0,0 +1,21 @@
+#ifndef __BENCH_MALLOC_H__
+#define __BENCH_MALLOC_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// called by a pattern when its live set is at its largest.  Only used by the native build,
+// the twr-wasm build uses the heap profiler, which tracks the exact peak
+void bench_sample_heap(void);
+
+// each pattern returns the number of operations it performed
+size_t bench_cxx_churn(int rounds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
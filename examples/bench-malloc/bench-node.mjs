@@ -0,0 +1,56 @@
+// Runs a benchmark under Node, and prints its JSON results to stdout
+//    node bench-node.mjs [file.wasm] [export] > results.json
+// the defaults are bench-malloc.wasm and bench_malloc.  For example, for the string benchmark:
+//    node bench-node.mjs ../bench-string/bench-string.wasm bench_string
+// a console named "benchout" is available, whose output is decoded and then discarded (see bench-printf)
+//
+// twrWasmModule requires a browser main thread (it looks for DOM elements when it creates the default consoles),
+// so this loads the module directly, and provides the few imports the benchmark uses.
+
+import {readFile} from "node:fs/promises";
+import {fileURLToPath} from "node:url";
+
+const wasmPath=process.argv[2] ?? fileURLToPath(new URL("./bench-malloc.wasm", import.meta.url));
+const benchExport=process.argv[3] ?? "bench_malloc";
+const STDIO_ID=1;
+const BENCHOUT_ID=2;
+const IO_TYPE_CHARWRITE=(1<<1);
+
+let memory;
+const decoder=new TextDecoder();
+
+function getString(idx) {
+   const mem8=new Uint8Array(memory.buffer);
+   let end=idx;
+   while (mem8[end]) end++;
+   return decoder.decode(mem8.subarray(idx, end));
+}
+
+function write(jsid, str) {
+   if (jsid!=BENCHOUT_ID) process.stdout.write(str);
+}
+
+const imports={
+   twrConCharOut: (jsid, c, codePage)=>write(jsid, String.fromCodePoint(c)),
+   twrConPutStr: (jsid, str, codePage)=>write(jsid, getString(str)),
+   twrConGetProp: (jsid, propName)=>getString(propName)=="type"?IO_TYPE_CHARWRITE:0,
+   twrConGetIDFromName: (name)=>getString(name)=="benchout"?BENCHOUT_ID:-1,
+   twrTimeEpoch: ()=>BigInt(Date.now()),
+   twr_register_callback: ()=>-1,
+};
+
+// any other import the library links in is not expected to be called by the benchmark
+const env=new Proxy(imports, {
+   get(target, name) {
+      if (name in target) return target[name];
+      return ()=>{ throw new Error("bench-node: import '"+String(name)+"' is not available under node"); };
+   }
+});
+
+const {instance}=await WebAssembly.instantiate(await readFile(wasmPath), {env});
+const exports=instance.exports;
+memory=exports.memory;
+
+exports.twr_wasm_init(STDIO_ID, STDIO_ID, -1, memory.buffer.byteLength);
+exports[benchExport]();
+exports.twr_wasm_flush?.();  // as twrWasmModule does when a C function returns
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <twr-crt.h>
+
+// stdio output benchmark
+// prints 1MB of text, a printf per line, with each stdio buffering mode, and with io_putc per byte (which is how
+// printf sent its output before stdio was buffered).  The text is sent to the console named "benchout" (stdout if there is none),
+// and the results are printed to stdout as JSON.
+//
+// bench_snprintf measures snprintf throughput for some typical log line formats.
+// bench_dtoa measures double to text conversion (%g, %.17g, %f, and %e) of random doubles, and of doubles with a few decimal digits.
+// bench_strtod measures text to double conversion (strtod) of 10M numbers of each of several kinds.
+
+#define TOTAL_BYTES (1024*1024)
+
+static const char* const mode_names[]={"", "fully_buffered", "line_buffered", "unbuffered"};  // indexed by _IOFBF, _IOLBF, _IONBF
+
+static uint64_t run_putc(FILE* out) {
+	char line[128];
+	int n=0, line_no=0;
+
+	const uint64_t start=twr_epoch_timems();
+	while (n<TOTAL_BYTES) {
+		const int len=snprintf(line, sizeof(line), "%6d: the quick brown fox jumps over the lazy dog %x\n", line_no, (line_no*2654435761u)>>4);
+		for (int i=0; i<len; i++)
+			io_putc(out, line[i]);
+		n+=len;
+		line_no++;
+	}
+	return twr_epoch_timems()-start;
+}
+
+static uint64_t run_printf(FILE* out, int mode) {
+	int n=0, line_no=0;
+
+	setvbuf(out, NULL, mode, 0);
+	const uint64_t start=twr_epoch_timems();
+	while (n<TOTAL_BYTES) {
+		n+=fprintf(out, "%6d: the quick brown fox jumps over the lazy dog %x\n", line_no, (line_no*2654435761u)>>4);
+		line_no++;
+	}
+	fflush(out);
+	return twr_epoch_timems()-start;
+}
+
+__attribute__((export_name("bench_printf")))
+void bench_printf(void) {
+	FILE* out=(FILE*)twr_get_console("benchout");
+	if (out==NULL) out=stdout;
+
+	const uint64_t putc_ms=run_putc(out);
+	uint64_t printf_ms[4];
+	for (int mode=_IOFBF; mode<=_IONBF; mode++)
+		printf_ms[mode]=run_printf(out, mode);
+	setvbuf(out, NULL, _IOLBF, 0);
+
+	printf("{\"benchmark\": \"printf\", \"bytes\": %d, \"results\": [\n", TOTAL_BYTES);
+	printf("    {\"name\": \"io_putc_per_byte\", \"ms\": %d},\n", (int)putc_ms);
+	for (int mode=_IOFBF; mode<=_IONBF; mode++)
+		printf("    {\"name\": \"printf_%s\", \"ms\": %d}%s\n", mode_names[mode], (int)printf_ms[mode], mode==_IONBF?"":",");
+	printf("]}\n");
+}
+
+/*************/
+
+static uint64_t run_snprintf(int format, int count, int* bytes) {
+	char line[256];
+	int n=0;
+
+	const uint64_t start=twr_epoch_timems();
+	for (int i=0; i<count; i++) {
+		switch (format) {
+			case 0: n+=snprintf(line, sizeof(line), "request complete: status=%d bytes=%d time=%dms\n", 200, i, i&1023); break;
+			case 1: n+=snprintf(line, sizeof(line), "[%s] %s:%d: %s\n", "info", "server.c", i&4095, "connection accepted"); break;
+			case 2: n+=snprintf(line, sizeof(line), "%08x %6d %-10s|%c\n", i, i&65535, "worker", 'A'+(i&15)); break;
+			case 3: n+=snprintf(line, sizeof(line), "an informational message that has no conversion specifications at all\n"); break;
+		}
+	}
+	*bytes=n;
+	return twr_epoch_timems()-start;
+}
+
+__attribute__((export_name("bench_snprintf")))
+void bench_snprintf(void) {
+	static const char* const names[]={"status_line", "source_location", "fixed_width", "literal_only"};
+	const int count=1000000;
+
+	printf("{\"benchmark\": \"snprintf\", \"count\": %d, \"results\": [\n", count);
+	for (int format=0; format<4; format++) {
+		int bytes;
+		const uint64_t ms=run_snprintf(format, count, &bytes);
+		printf("    {\"name\": \"%s\", \"ms\": %d, \"mb_per_sec\": %d}%s\n", names[format], (int)ms, ms ? (int)(bytes/(ms*1000)) : 0, format==3?"":",");
+	}
+	printf("]}\n");
+}
+
+/*************/
+
+static uint64_t xorshift(uint64_t* state) {
+	*state^=*state<<13;
+	*state^=*state>>7;
+	*state^=*state<<17;
+	return *state;
+}
+
+// kind 0 is random bit patterns (most are very large or very small), kind 1 is values like 1234.56
+static double bench_value(uint64_t* state, int kind) {
+	double d;
+	if (kind==0) {
+		uint64_t bits;
+		do {
+			bits=xorshift(state);
+			memcpy(&d, &bits, sizeof(d));
+		} while (d!=d || d-d!=0);  // skip NaN and infinity
+	}
+	else {
+		d=(double)(int)(xorshift(state)%10000000)/100.0;
+	}
+	return d;
+}
+
+static uint64_t run_dtoa(int format, int kind, int count) {
+	char line[64];
+	uint64_t state=88172645463325252ULL;
+
+	const uint64_t start=twr_epoch_timems();
+	for (int i=0; i<count; i++) {
+		const double d=bench_value(&state, kind);
+		switch (format) {
+			case 0: snprintf(line, sizeof(line), "%g", d); break;
+			case 1: snprintf(line, sizeof(line), "%.17g", d); break;
+			case 2: snprintf(line, sizeof(line), "%f", kind==0 ? d*1e-300 : d); break;  // %f of a large value is long, so keep them small
+			case 3: snprintf(line, sizeof(line), "%e", d); break;
+		}
+	}
+	return twr_epoch_timems()-start;
+}
+
+__attribute__((export_name("bench_dtoa")))
+void bench_dtoa(void) {
+	static const char* const names[]={"g", "g17", "f", "e"};
+	static const char* const kind_names[]={"random_bits", "cents"};
+	const int count=1000000;
+
+	printf("{\"benchmark\": \"dtoa\", \"count\": %d, \"results\": [\n", count);
+	for (int kind=0; kind<2; kind++) {
+		for (int format=0; format<4; format++) {
+			const uint64_t ms=run_dtoa(format, kind, count);
+			printf("    {\"name\": \"%s_%s\", \"ms\": %d}%s\n", names[format], kind_names[kind], (int)ms, kind==1 && format==3?"":",");
+		}
+	}
+	printf("]}\n");
+}
+
+/*************/
+
+#define STRTOD_VALUES_PER_BUF 1000
+
+// kind 0 is %.17g of random bit patterns, kind 1 is values like 1234.56, kind 2 is integers,
+// and kind 3 is 20 significant digits (more than fit in 64 bits), which sometimes need the exact fallback
+static int make_strtod_buf(char* buf, int size, int kind) {
+	uint64_t state=88172645463325252ULL;
+	int n=0;
+
+	for (int i=0; i<STRTOD_VALUES_PER_BUF; i++) {
+		switch (kind) {
+			case 0: n+=snprintf(buf+n, size-n, "%.17g ", bench_value(&state, 0)); break;
+			case 1: n+=snprintf(buf+n, size-n, "%.2f ", bench_value(&state, 1)); break;
+			case 2: n+=snprintf(buf+n, size-n, "%d ", (int)(xorshift(&state)%100000000)); break;
+			case 3: n+=snprintf(buf+n, size-n, "%.19e ", bench_value(&state, 0)); break;
+		}
+	}
+	return n;
+}
+
+static uint64_t run_strtod(const char* buf, int count, double* sum) {
+	double total=0;
+
+	const uint64_t start=twr_epoch_timems();
+	for (int i=0; i<count; i+=STRTOD_VALUES_PER_BUF) {
+		const char* p=buf;
+		char* end;
+		for (int j=0; j<STRTOD_VALUES_PER_BUF; j++) {
+			total+=strtod(p, &end);
+			p=end;
+		}
+	}
+	*sum=total;
+	return twr_epoch_timems()-start;
+}
+
+__attribute__((export_name("bench_strtod")))
+void bench_strtod(void) {
+	static const char* const names[]={"g17_random_bits", "cents", "integers", "digits20_random_bits"};
+	static char buf[STRTOD_VALUES_PER_BUF*32];
+	const int count=10000000;
+
+	printf("{\"benchmark\": \"strtod\", \"count\": %d, \"results\": [\n", count);
+	for (int kind=0; kind<4; kind++) {
+		make_strtod_buf(buf, sizeof(buf), kind);
+		double sum;
+		const uint64_t ms=run_strtod(buf, count, &sum);
+		printf("    {\"name\": \"%s\", \"ms\": %d, \"numbers_per_sec\": %d}%s\n", names[kind], (int)ms, ms ? (int)(count*1000ULL/ms) : 0, kind==3?"":",");
+	}
+	printf("]}\n");
+}
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <twr-crt.h>
+#include <algorithm>
+
+// qsort() vs libc++ std::sort, on the same data
+// std::sort inlines the comparison, while qsort calls it through a function pointer, so std::sort is expected to be faster.
+// This benchmark is to track how close qsort is.  Results are printed as JSON.
+
+struct elem16 {
+   int32_t key;
+   int32_t payload[3];
+};
+
+static int compare_int(const void* a, const void* b) {
+   const int x=*(const int*)a, y=*(const int*)b;
+   return x<y ? -1 : x>y;
+}
+
+static int compare_double(const void* a, const void* b) {
+   const double x=*(const double*)a, y=*(const double*)b;
+   return x<y ? -1 : x>y;
+}
+
+static int compare_elem16(const void* a, const void* b) {
+   return compare_int(&((const elem16*)a)->key, &((const elem16*)b)->key);
+}
+
+static uint32_t seed;
+static int next_rand() {
+   seed=seed*1103515245+12345;
+   return (int)(seed>>1);
+}
+
+enum pattern {RANDOM, SORTED, FEW_VALUES};
+static const char* pattern_names[]={"random", "sorted", "few_values"};
+
+static int value(pattern p, int i) {
+   switch (p) {
+      case RANDOM: return next_rand();
+      case SORTED: return i;
+      case FEW_VALUES: return next_rand()%16;
+   }
+   return 0;
+}
+
+template<typename T> static void fill(T* a, int n, pattern p);
+
+template<> void fill(int* a, int n, pattern p) {
+   for (int i=0; i<n; i++) a[i]=value(p, i);
+}
+
+template<> void fill(double* a, int n, pattern p) {
+   for (int i=0; i<n; i++) a[i]=value(p, i)/7.0;
+}
+
+template<> void fill(elem16* a, int n, pattern p) {
+   for (int i=0; i<n; i++) a[i]={value(p, i), {i, i, i}};
+}
+
+template<typename T, typename Less>
+static void run(const char* name, int n, pattern p, int (*compar)(const void*, const void*), Less less, bool last) {
+   T* a=(T*)malloc(n*sizeof(T));
+   T* b=(T*)malloc(n*sizeof(T));
+   seed=1;
+   fill(a, n, p);
+   memcpy(b, a, n*sizeof(T));
+
+   uint64_t start=twr_epoch_timems();
+   qsort(a, n, sizeof(T), compar);
+   const uint64_t qsort_ms=twr_epoch_timems()-start;
+
+   start=twr_epoch_timems();
+   std::sort(b, b+n, less);
+   const uint64_t std_sort_ms=twr_epoch_timems()-start;
+
+   bool same=true;
+   for (int i=0; i<n; i++)
+      if (compar(&a[i], &b[i])!=0) same=false;
+
+   printf("    {\"name\": \"%s\", \"pattern\": \"%s\", \"n\": %d, \"qsort_ms\": %lu, \"std_sort_ms\": %lu, \"same\": %s}%s\n",
+      name, pattern_names[p], n, (unsigned long)qsort_ms, (unsigned long)std_sort_ms, same?"true":"false", last?"":",");
+
+   free(a);
+   free(b);
+}
+
+extern "C" __attribute__((export_name("bench_sort")))
+void bench_sort() {
+   const int n=1000000;
+   printf("{\"benchmark\": \"sort\", \"results\": [\n");
+   for (int p=RANDOM; p<=FEW_VALUES; p++) {
+      run<int>("int", n, (pattern)p, compare_int, [](int x, int y) { return x<y; }, false);
+      run<double>("double", n, (pattern)p, compare_double, [](double x, double y) { return x<y; }, false);
+      run<elem16>("elem16", n/4, (pattern)p, compare_elem16, [](const elem16& x, const elem16& y) { return x.key<y.key; }, p==FEW_VALUES);
+   }
+   printf("]}\n");
+}
@@ -0,0 +1,143 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <twr-crt.h>
+
+// string and memory function throughput benchmark
+// times the twr-wasm strlen, strchr, memchr, strcmp, and strncmp against byte at a time versions, for several string lengths,
+// and memmove (of overlapping regions), memset, bzero, and memcmp for sizes from 8 bytes to 1MB.
+// bench-string.simd.wasm is linked with twr-simd.a, where the library functions process 16 bytes per iteration.
+// Results are printed as JSON, in MB/s.
+
+#define BYTES_PER_TEST (32*1024*1024)
+#define MAX_LEN (1024*1024)
+
+static char* str1;
+static char* str2;
+static volatile size_t sink;
+
+static __attribute__((noinline)) size_t ref_strlen(const char* s) {
+	size_t k=0;
+	while (s[k]) k++;
+	return k;
+}
+
+static __attribute__((noinline)) char* ref_strchr(const char* s, int ch) {
+	while (*s!=(char)ch) {
+		if (*s==0) return NULL;
+		s++;
+	}
+	return (char*)s;
+}
+
+static __attribute__((noinline)) void* ref_memchr(const void* p, int ch, size_t n) {
+	const unsigned char* s=p;
+	for (size_t k=0; k<n; k++)
+		if (s[k]==(unsigned char)ch) return (void*)(s+k);
+	return NULL;
+}
+
+static __attribute__((noinline)) int ref_memcmp(const void* lhs, const void* rhs, size_t n) {
+	const unsigned char* l=lhs;
+	const unsigned char* r=rhs;
+	for (size_t k=0; k<n; k++)
+		if (l[k]!=r[k]) return l[k]<r[k]?-1:1;
+	return 0;
+}
+
+static __attribute__((noinline)) void* ref_memmove(void* dest, const void* src, size_t n) {
+	unsigned char* to=dest;
+	const unsigned char* from=src;
+	if (to>from)
+		for (size_t k=n; k>0; k--) to[k-1]=from[k-1];
+	else
+		for (size_t k=0; k<n; k++) to[k]=from[k];
+	return dest;
+}
+
+static __attribute__((noinline)) void* ref_memset(void* mem, int c, size_t n) {
+	unsigned char* p=mem;
+	for (size_t k=0; k<n; k++) p[k]=(unsigned char)c;
+	return mem;
+}
+
+static __attribute__((noinline)) int ref_strncmp(const char* lhs, const char* rhs, size_t n) {
+	const unsigned char* l=(const unsigned char*)lhs;
+	const unsigned char* r=(const unsigned char*)rhs;
+	for (size_t k=0; k<n; k++) {
+		if (l[k]!=r[k]) return l[k]<r[k]?-1:1;
+		if (l[k]==0) return 0;
+	}
+	return 0;
+}
+
+static __attribute__((noinline)) int ref_strcmp(const char* lhs, const char* rhs) {
+	return ref_strncmp(lhs, rhs, (size_t)-1);
+}
+
+enum func {F_STRLEN, F_STRCHR, F_MEMCHR, F_STRCMP, F_STRNCMP, F_MEMMOVE, F_MEMSET, F_BZERO, F_MEMCMP};
+static const char* func_names[]={"strlen", "strchr", "memchr", "strcmp", "strncmp", "memmove", "memset", "bzero", "memcmp"};
+
+// each call scans len bytes: the character searched for, and the difference compared, are at the end
+static size_t call(enum func f, bool ref, size_t len) {
+	switch (f) {
+		case F_STRLEN:  return ref ? ref_strlen(str1) : strlen(str1);
+		case F_STRCHR:  return (size_t)(ref ? ref_strchr(str1, '!') : strchr(str1, '!'));
+		case F_MEMCHR:  return (size_t)(ref ? ref_memchr(str1, 0, len) : memchr(str1, 0, len));
+		case F_STRCMP:  return ref ? ref_strcmp(str1, str2) : strcmp(str1, str2);
+		case F_STRNCMP: return ref ? ref_strncmp(str1, str2, len) : strncmp(str1, str2, len);
+		case F_MEMMOVE: return (size_t)(ref ? ref_memmove(str1+1, str1, len) : memmove(str1+1, str1, len));
+		case F_MEMSET:  return (size_t)(ref ? ref_memset(str1, 'a', len) : memset(str1, 'a', len));
+		case F_BZERO:   if (ref) ref_memset(str1, 0, len); else bzero(str1, len); return 0;
+		case F_MEMCMP:  return ref ? ref_memcmp(str1, str2, len) : memcmp(str1, str2, len);
+	}
+	return 0;
+}
+
+static unsigned long mb_per_sec(enum func f, bool ref, size_t len) {
+	const size_t calls=BYTES_PER_TEST/len;
+	const uint64_t start=twr_epoch_timems();
+	for (size_t i=0; i<calls; i++)
+		sink+=call(f, ref, len);
+	uint64_t ms=twr_epoch_timems()-start;
+	if (ms==0) ms=1;
+	return (unsigned long)((uint64_t)calls*len/1000/ms);
+}
+
+static void print_result(enum func f, size_t len, bool last) {
+	// len-1 characters, with the last one different in str2, and a '!' to find
+	memset(str1, 'a', len-1);
+	str1[len-1]=0;
+	str1[len-2]='!';
+	memcpy(str2, str1, len);
+	str2[len-2]='?';
+
+	const unsigned long lib=mb_per_sec(f, false, len);
+	const unsigned long ref=mb_per_sec(f, true, len);
+	printf("    {\"name\": \"%s\", \"len\": %lu, \"twr\": %lu, \"byte_at_a_time\": %lu}%s\n",
+		func_names[f], (unsigned long)len, lib, ref, last?"":",");
+}
+
+__attribute__((export_name("bench_string")))
+void bench_string(void) {
+	static const size_t str_lengths[]={16, 64, 1024, 64*1024};
+	static const size_t mem_lengths[]={8, 64, 512, 4096, 32*1024, 256*1024, MAX_LEN};
+	const int num_str_lengths=sizeof(str_lengths)/sizeof(str_lengths[0]);
+	const int num_mem_lengths=sizeof(mem_lengths)/sizeof(mem_lengths[0]);
+
+	str1=malloc(MAX_LEN+1);
+	str2=malloc(MAX_LEN+1);
+
+	printf("{\"benchmark\": \"string\", \"units\": \"MB/s\", \"results\": [\n");
+	for (int f=F_STRLEN; f<=F_STRNCMP; f++)
+		for (int i=0; i<num_str_lengths; i++)
+			print_result(f, str_lengths[i], false);
+	for (int f=F_MEMMOVE; f<=F_MEMCMP; f++)
+		for (int i=0; i<num_mem_lengths; i++)
+			print_result(f, mem_lengths[i], f==F_MEMCMP && i==num_mem_lengths-1);
+	printf("]}\n");
+
+	free(str1);
+	free(str2);
+}
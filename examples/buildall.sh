@@ -85,5 +85,25 @@ cd ../tests-timer
 $make clean
 $make
 
+cd ../bench-malloc
+$make clean
+$make
+
+cd ../bench-string
+$make clean
+$make
+
+cd ../bench-sort
+$make clean
+$make
+
+cd ../bench-hashmap
+$make clean
+$make
+
+cd ../bench-printf
+$make clean
+$make
+
 
 
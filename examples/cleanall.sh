@@ -59,6 +59,21 @@ $make clean
 cd ../tests-audio
 $make clean
 
+cd ../bench-malloc
+$make clean
+
+cd ../bench-string
+$make clean
+
+cd ../bench-sort
+$make clean
+
+cd ../bench-hashmap
+$make clean
+
+cd ../bench-printf
+$make clean
+
 cd ..
 
 
@@ -8,6 +8,7 @@
 #include <typeinfo>
 #include <string_view>
 #include <cuchar> // For char16_t and char32_t conversions
+#include <new>
 
 bool testUnicodeSupport(void);
 bool testRttiSupported(void);
@@ -146,6 +147,26 @@ void dotest() {
 
 	//////////////////////////////////////////////
 
+	// over-aligned new uses aligned_alloc
+	struct alignas(64) CacheLine { char data[64]; };
+	CacheLine* cl = new CacheLine[3];
+	if (((uintptr_t)cl & 63)!=0) {
+		printf("ERROR! %d\n",__LINE__);
+		abort();
+	}
+	delete[] cl;
+
+	void* page = ::operator new(1000, std::align_val_t(64*1024));
+	if (((uintptr_t)page & 0xFFFF)!=0) {
+		printf("ERROR! %d\n",__LINE__);
+		abort();
+	}
+	::operator delete(page, std::align_val_t(64*1024));
+
+	std::cout << "Aligned new OK" << std::endl;
+
+	//////////////////////////////////////////////
+
 	std::cout << "Normal End\n";
 
 }
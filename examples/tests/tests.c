@@ -12,6 +12,8 @@ int tests() {
 	printf("starting unit tests of twr-wasm...\n");
 
 	printf("malloc_unit_test: %s\n", malloc_unit_test()?"success":"FAIL");
+	printf("arena_unit_test: %s\n", arena_unit_test()?"success":"FAIL");
+	printf("hashmap_unit_test: %s\n", hashmap_unit_test()?"success":"FAIL");
 	printf("locale_unit_test: %s\n", locale_unit_test()?"success":"FAIL");
 	printf("rand_unit_test: %s\n", rand_unit_test()?"success":"FAIL");
 	printf("math_unit_test: %s\n", math_unit_test()?"success":"FAIL");
@@ -22,6 +24,7 @@ int tests() {
 	printf("atof_unit_test: %s\n", atof_unit_test()?"success":"FAIL");
 	printf("twr_dtoa_unit_test: %s\n", twr_dtoa_unit_test()?"success":"FAIL");
 	printf("string_unit_test: %s\n", string_unit_test()?"success":"FAIL");
+	printf("qsort_unit_test: %s\n", qsort_unit_test()?"success":"FAIL");
 	printf("printf_unit_test: %s\n", printf_unit_test()?"success":"FAIL");
 	printf("mbstring_unit_test: %s\n", mbstring_unit_test()?"success":"FAIL");
    
@@ -16,37 +16,44 @@ twr_ioconsole_t * twr_get_std2d_con() {
 	return __std2d;
 }
 
+// instructions (and the strings and arrays they point to) are allocated from the draw sequence's arena,
+// so freeing them after a flush is a single arena reset.
 void d2d_free_instructions(struct d2d_draw_seq* ds) {
     assert(ds);
     if (ds) {
-        struct d2d_instruction_hdr *next=ds->start;
-
-        while (next) {
-            //twr_conlog("free instruction me %x type %x next %x",next, next->type, next->next);
-            struct d2d_instruction_hdr * nextnext=next->next;
-            if (next->heap_ptr != NULL) {
-               twr_cache_free(next->heap_ptr);
-            }
-            if (next->heap_ptr2 != NULL) {
-               twr_cache_free(next->heap_ptr2);
-            }
-            twr_cache_free(next);
-            next=nextnext;
-        }
+        twr_arena_reset(ds->arena);
         ds->start=0;
         ds->last=0;
     }
 }
 
-char* cache_strdup(const char* str) {
+static void* d2d_alloc(struct d2d_draw_seq* ds, size_t size) {
+   void* mem=twr_arena_alloc(ds->arena, size);
+   assert(mem);
+   return mem;
+}
+
+static char* d2d_strdup(struct d2d_draw_seq* ds, const char* str) {
    size_t len = strlen(str) + 1; //include null terminator
-   char* ret = (char*)twr_cache_malloc(len);
+   char* ret = (char*)d2d_alloc(ds, len);
    
    memcpy(ret, str, len);
 
    return ret;
 }
 
+// the arena of the last ended draw sequence is kept for the next one, so that a draw sequence per frame doesn't malloc
+static twr_arena_t* spare_arena;
+
+// when malloc runs out of memory, the spare arena is freed.  The next draw sequence creates a new one.
+static size_t d2d_memory_pressure(size_t size) {
+    if (spare_arena==NULL) return 0;
+    const size_t before=avail();
+    twr_arena_destroy(spare_arena);
+    spare_arena=NULL;
+    return avail()-before;
+}
+
 static void invalidate_cache(struct d2d_draw_seq* ds) {
     ds->last_fillstyle_color_valid=false;
     ds->last_strokestyle_color_valid=false;
@@ -57,6 +64,14 @@ struct d2d_draw_seq* d2d_start_draw_sequence_with_con(int flush_at_ins_count, tw
     //twr_conlog("C: d2d_start_draw_sequence");
     struct d2d_draw_seq* ds = twr_cache_malloc(sizeof(struct d2d_draw_seq));
     assert(ds);
+    if (spare_arena) {
+        ds->arena=spare_arena;
+        spare_arena=NULL;
+    }
+    else {
+        ds->arena=twr_arena_create(0);
+        assert(ds->arena);
+    }
     ds->last=0;
     ds->start=0;
     ds->ins_count=0;
@@ -74,6 +89,14 @@ void d2d_end_draw_sequence(struct d2d_draw_seq* ds) {
     //twr_conlog("C: end_draw_seq");
     d2d_flush(ds);
     if (ds) {  // should never happen -- ie, ds==NULL
+        if (spare_arena==NULL) {
+            static bool registered;
+            if (!registered)
+                registered=twr_register_memory_pressure_handler(d2d_memory_pressure);
+            spare_arena=ds->arena;
+        }
+        else
+            twr_arena_destroy(ds->arena);
         twr_cache_free(ds);
     }
     // printf("available: %ld\n", avail());
@@ -125,7 +148,7 @@ int d2d_get_canvas_prop(const char* prop_name) {
 }
 
 void d2d_fillrect(struct d2d_draw_seq* ds, double x, double y, double w, double h) {
-    struct d2dins_fillrect* r= twr_cache_malloc(sizeof(struct d2dins_fillrect));
+    struct d2dins_fillrect* r= d2d_alloc(ds, sizeof(struct d2dins_fillrect));
     r->hdr.type=D2D_FILLRECT;
     r->x=x;
     r->y=y;
@@ -136,7 +159,7 @@ void d2d_fillrect(struct d2d_draw_seq* ds, double x, double y, double w, double
 }
 
 void d2d_strokerect(struct d2d_draw_seq* ds, double x, double y, double w, double h) {
-    struct d2dins_strokerect* r= twr_cache_malloc(sizeof(struct d2dins_strokerect));
+    struct d2dins_strokerect* r= d2d_alloc(ds, sizeof(struct d2dins_strokerect));
     r->hdr.type=D2D_STROKERECT;
     r->x=x;
     r->y=y;
@@ -148,7 +171,7 @@ void d2d_strokerect(struct d2d_draw_seq* ds, double x, double y, double w, doubl
 void d2d_setlinewidth(struct d2d_draw_seq* ds, double width) {
     if (ds->last_line_width!=width) {
         ds->last_line_width=width;
-        struct d2dins_setlinewidth* e= twr_cache_malloc(sizeof(struct d2dins_setlinewidth));
+        struct d2dins_setlinewidth* e= d2d_alloc(ds, sizeof(struct d2dins_setlinewidth));
         e->hdr.type=D2D_SETLINEWIDTH;
         e->width=width;
         set_ptrs(ds, &e->hdr, NULL, NULL);  
@@ -162,7 +185,7 @@ void d2d_setfillstylergba(struct d2d_draw_seq* ds, unsigned long color) {
     if (!(ds->last_fillstyle_color_valid && color==ds->last_fillstyle_color)) {
         ds->last_fillstyle_color=color;
         ds->last_fillstyle_color_valid=true;
-        struct d2dins_setfillstylergba* e= twr_cache_malloc(sizeof(struct d2dins_setfillstylergba));
+        struct d2dins_setfillstylergba* e= d2d_alloc(ds, sizeof(struct d2dins_setfillstylergba));
         e->hdr.type=D2D_SETFILLSTYLERGBA;
         e->color=color;
         set_ptrs(ds, &e->hdr, NULL, NULL);  
@@ -176,7 +199,7 @@ void d2d_setstrokestylergba(struct d2d_draw_seq* ds, unsigned long color) {
     if (!(ds->last_strokestyle_color_valid && color==ds->last_strokestyle_color)) {
         ds->last_strokestyle_color=color;
         ds->last_strokestyle_color_valid=true;
-        struct d2dins_setstrokestylergba* e= twr_cache_malloc(sizeof(struct d2dins_setstrokestylergba));
+        struct d2dins_setstrokestylergba* e= d2d_alloc(ds, sizeof(struct d2dins_setstrokestylergba));
         e->hdr.type=D2D_SETSTROKESTYLERGBA;
         e->color=color;
         set_ptrs(ds, &e->hdr, NULL, NULL);  
@@ -184,59 +207,59 @@ void d2d_setstrokestylergba(struct d2d_draw_seq* ds, unsigned long color) {
 }
 
 void d2d_setfillstyle(struct d2d_draw_seq* ds, const char* css_color) {
-    struct d2dins_setfillstyle* e= twr_cache_malloc(sizeof(struct d2dins_setfillstyle));
+    struct d2dins_setfillstyle* e= d2d_alloc(ds, sizeof(struct d2dins_setfillstyle));
     e->hdr.type=D2D_SETFILLSTYLE;
-    e->css_color=cache_strdup(css_color);
+    e->css_color=d2d_strdup(ds, css_color);
     set_ptrs(ds, &e->hdr, (void*)e->css_color, NULL); 
 }
 
 void d2d_setstrokestyle(struct d2d_draw_seq* ds, const char* css_color) {
-    struct d2dins_setstrokestyle* e= twr_cache_malloc(sizeof(struct d2dins_setstrokestyle));
+    struct d2dins_setstrokestyle* e= d2d_alloc(ds, sizeof(struct d2dins_setstrokestyle));
     e->hdr.type=D2D_SETSTROKESTYLE;
-    e->css_color=cache_strdup(css_color);
+    e->css_color=d2d_strdup(ds, css_color);
     set_ptrs(ds, &e->hdr, (void*)e->css_color, NULL); 
 }
 
 void d2d_setfont(struct d2d_draw_seq* ds, const char* font) {
-    struct d2dins_setfont* e= twr_cache_malloc(sizeof(struct d2dins_setfont));
+    struct d2dins_setfont* e= d2d_alloc(ds, sizeof(struct d2dins_setfont));
     e->hdr.type=D2D_SETFONT;
-    e->font=cache_strdup(font);
+    e->font=d2d_strdup(ds, font);
     set_ptrs(ds, &e->hdr, (void*)e->font, NULL); 
 }
 
 void d2d_beginpath(struct d2d_draw_seq* ds) {
-    struct d2dins_beginpath* e= twr_cache_malloc(sizeof(struct d2dins_beginpath));
+    struct d2dins_beginpath* e= d2d_alloc(ds, sizeof(struct d2dins_beginpath));
     e->hdr.type=D2D_BEGINPATH;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_fill(struct d2d_draw_seq* ds) {
-    struct d2dins_fill* e= twr_cache_malloc(sizeof(struct d2dins_fill));
+    struct d2dins_fill* e= d2d_alloc(ds, sizeof(struct d2dins_fill));
     e->hdr.type=D2D_FILL;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_stroke(struct d2d_draw_seq* ds) {
-    struct d2dins_stroke* e= twr_cache_malloc(sizeof(struct d2dins_stroke));
+    struct d2dins_stroke* e= d2d_alloc(ds, sizeof(struct d2dins_stroke));
     e->hdr.type=D2D_STROKE;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_save(struct d2d_draw_seq* ds) {
-    struct d2dins_save* e= twr_cache_malloc(sizeof(struct d2dins_save));
+    struct d2dins_save* e= d2d_alloc(ds, sizeof(struct d2dins_save));
     e->hdr.type=D2D_SAVE;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_restore(struct d2d_draw_seq* ds) {
-    struct d2dins_restore* e= twr_cache_malloc(sizeof(struct d2dins_restore));
+    struct d2dins_restore* e= d2d_alloc(ds, sizeof(struct d2dins_restore));
     invalidate_cache(ds);
     e->hdr.type=D2D_RESTORE;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_moveto(struct d2d_draw_seq* ds, double x, double y) {
-    struct d2dins_moveto* e= twr_cache_malloc(sizeof(struct d2dins_moveto));
+    struct d2dins_moveto* e= d2d_alloc(ds, sizeof(struct d2dins_moveto));
     e->hdr.type=D2D_MOVETO;
     e->x=x;
     e->y=y;
@@ -244,7 +267,7 @@ void d2d_moveto(struct d2d_draw_seq* ds, double x, double y) {
 }
 
 void d2d_lineto(struct d2d_draw_seq* ds, double x, double y) {
-    struct d2dins_lineto* e= twr_cache_malloc(sizeof(struct d2dins_lineto));
+    struct d2dins_lineto* e= d2d_alloc(ds, sizeof(struct d2dins_lineto));
     e->hdr.type=D2D_LINETO;
     e->x=x;
     e->y=y;
@@ -252,7 +275,7 @@ void d2d_lineto(struct d2d_draw_seq* ds, double x, double y) {
 }
 
 void d2d_arc(struct d2d_draw_seq* ds, double x, double y, double radius, double start_angle, double end_angle, bool counterclockwise) {
-    struct d2dins_arc* e= twr_cache_malloc(sizeof(struct d2dins_arc));
+    struct d2dins_arc* e= d2d_alloc(ds, sizeof(struct d2dins_arc));
     e->hdr.type=D2D_ARC;
     e->x=x;
     e->y=y;
@@ -264,7 +287,7 @@ void d2d_arc(struct d2d_draw_seq* ds, double x, double y, double radius, double
 }
 
 void d2d_bezierto(struct d2d_draw_seq* ds, double cp1x, double cp1y, double cp2x, double cp2y, double x, double y) {
-    struct d2dins_bezierto* e= twr_cache_malloc(sizeof(struct d2dins_bezierto));
+    struct d2dins_bezierto* e= d2d_alloc(ds, sizeof(struct d2dins_bezierto));
     e->hdr.type=D2D_BEZIERTO;
     e->cp1x=cp1x;
     e->cp1y=cp1y;
@@ -277,18 +300,18 @@ void d2d_bezierto(struct d2d_draw_seq* ds, double cp1x, double cp1y, double cp2x
 
 
 void d2d_filltext(struct d2d_draw_seq* ds, const char* str, double x, double y) {
-    struct d2dins_filltext* e= twr_cache_malloc(sizeof(struct d2dins_filltext));
+    struct d2dins_filltext* e= d2d_alloc(ds, sizeof(struct d2dins_filltext));
     e->hdr.type=D2D_FILLTEXT;
     e->x=x;
     e->y=y;
-    e->str=cache_strdup(str);
+    e->str=d2d_strdup(ds, str);
 	 e->code_page=__get_current_lc_ctype_code_page_modified();
     set_ptrs(ds, &e->hdr, (void*)e->str, NULL);
 }
 
 // c is a unicode 32 bit codepoint
 void d2d_fillcodepoint(struct d2d_draw_seq* ds, unsigned long c, double x, double y) {
-    struct d2dins_fillcodepoint* e= twr_cache_malloc(sizeof(struct d2dins_fillcodepoint));
+    struct d2dins_fillcodepoint* e= d2d_alloc(ds, sizeof(struct d2dins_fillcodepoint));
     e->hdr.type=D2D_FILLCODEPOINT;
     e->x=x;
     e->y=y;
@@ -298,11 +321,11 @@ void d2d_fillcodepoint(struct d2d_draw_seq* ds, unsigned long c, double x, doubl
 }
 
 void d2d_stroketext(struct d2d_draw_seq* ds, const char* str, double x, double y) {
-    struct d2dins_stroketext* r = twr_cache_malloc(sizeof(struct d2dins_stroketext));
+    struct d2dins_stroketext* r = d2d_alloc(ds, sizeof(struct d2dins_stroketext));
     r->hdr.type=D2D_STROKETEXT;
     r->x=x;
     r->y=y;
-    r->str=cache_strdup(str);
+    r->str=d2d_strdup(ds, str);
     r->code_page=__get_current_lc_ctype_code_page_modified();
     set_ptrs(ds, &r->hdr, (void*)r->str, NULL);
 }
@@ -310,7 +333,7 @@ void d2d_stroketext(struct d2d_draw_seq* ds, const char* str, double x, double y
 // causes a flush so that a result is returned in *tm
 // since it immediately flushes, it doesn't need to duplicate the input str
 void d2d_measuretext(struct d2d_draw_seq* ds, const char* str, struct d2d_text_metrics *tm) {
-    struct d2dins_measuretext* e= twr_cache_malloc(sizeof(struct d2dins_measuretext));
+    struct d2dins_measuretext* e= d2d_alloc(ds, sizeof(struct d2dins_measuretext));
 
     e->hdr.type=D2D_MEASURETEXT;
     e->str=str;
@@ -322,7 +345,7 @@ void d2d_measuretext(struct d2d_draw_seq* ds, const char* str, struct d2d_text_m
 
 //needs to be static or flushed before mem goes out of scope
 void d2d_ctoimagedata(struct d2d_draw_seq* ds, long id, void* mem, unsigned long length, unsigned long width, unsigned long height) {
-     struct d2dins_c_to_image_data* e= twr_cache_malloc(sizeof(struct d2dins_c_to_image_data));
+     struct d2dins_c_to_image_data* e= d2d_alloc(ds, sizeof(struct d2dins_c_to_image_data));
     e->hdr.type=D2D_IMAGEDATA;
     e->start=mem-(void*)0;
     e->length=length;
@@ -343,7 +366,7 @@ void d2d_putimagedata(struct d2d_draw_seq* ds, long id, unsigned long dx, unsign
 }
 
 void d2d_putimagedatadirty(struct d2d_draw_seq* ds, long id, unsigned long dx, unsigned long dy, unsigned long dirtyX, unsigned long dirtyY, unsigned long dirtyWidth, unsigned long dirtyHeight) {
-    struct d2dins_put_image_data* e= twr_cache_malloc(sizeof(struct d2dins_put_image_data));
+    struct d2dins_put_image_data* e= d2d_alloc(ds, sizeof(struct d2dins_put_image_data));
     e->hdr.type=D2D_PUTIMAGEDATA;
     assert(sizeof(void*)==4);  // ensure 32 bit architecture, 64 bit not supported 
     e->id=id; 
@@ -357,7 +380,7 @@ void d2d_putimagedatadirty(struct d2d_draw_seq* ds, long id, unsigned long dx, u
 }
 
 void d2d_createradialgradient(struct d2d_draw_seq* ds, long id, double x0, double y0, double radius0, double x1, double y1, double radius1) {
-    struct d2dins_create_radial_gradient* e= twr_cache_malloc(sizeof(struct d2dins_create_radial_gradient));
+    struct d2dins_create_radial_gradient* e= d2d_alloc(ds, sizeof(struct d2dins_create_radial_gradient));
     e->hdr.type=D2D_CREATERADIALGRADIENT;
     e->id=id;
     e->x0=x0;
@@ -370,7 +393,7 @@ void d2d_createradialgradient(struct d2d_draw_seq* ds, long id, double x0, doubl
 }
 
 void d2d_createlineargradient(struct d2d_draw_seq* ds, long id, double x0, double y0, double x1, double y1) {
-    struct d2dins_create_linear_gradient* e= twr_cache_malloc(sizeof(struct d2dins_create_linear_gradient));
+    struct d2dins_create_linear_gradient* e= d2d_alloc(ds, sizeof(struct d2dins_create_linear_gradient));
     e->hdr.type=D2D_CREATELINEARGRADIENT;
     e->id=id;
     e->x0=x0;
@@ -381,43 +404,43 @@ void d2d_createlineargradient(struct d2d_draw_seq* ds, long id, double x0, doubl
 }
 
 void d2d_addcolorstop(struct d2d_draw_seq* ds, long gradid, long position, const char* csscolor) {
-    struct d2dins_set_color_stop* e= twr_cache_malloc(sizeof(struct d2dins_set_color_stop));
+    struct d2dins_set_color_stop* e= d2d_alloc(ds, sizeof(struct d2dins_set_color_stop));
     e->hdr.type=D2D_SETCOLORSTOP;
     e->id=gradid;
     e->position=position;
-    e->csscolor=cache_strdup(csscolor);
+    e->csscolor=d2d_strdup(ds, csscolor);
     set_ptrs(ds, &e->hdr, (void*)e->csscolor, NULL); 
 }
 
 void d2d_setfillstylegradient(struct d2d_draw_seq* ds, long gradid) {
-    struct d2dins_set_fillstyle_gradient* e= twr_cache_malloc(sizeof(struct d2dins_set_fillstyle_gradient));
+    struct d2dins_set_fillstyle_gradient* e= d2d_alloc(ds, sizeof(struct d2dins_set_fillstyle_gradient));
     e->hdr.type=D2D_SETFILLSTYLEGRADIENT;
     e->id=gradid;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_releaseid(struct d2d_draw_seq* ds, long id) {
-    struct d2dins_release_id* e= twr_cache_malloc(sizeof(struct d2dins_release_id));
+    struct d2dins_release_id* e= d2d_alloc(ds, sizeof(struct d2dins_release_id));
     e->hdr.type=D2D_RELEASEID;
     e->id=id;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_closepath(struct d2d_draw_seq* ds) {
-    struct d2dins_closepath* e= twr_cache_malloc(sizeof(struct d2dins_closepath));
+    struct d2dins_closepath* e= d2d_alloc(ds, sizeof(struct d2dins_closepath));
     e->hdr.type=D2D_CLOSEPATH;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_reset(struct d2d_draw_seq* ds) {
     invalidate_cache(ds);
-    struct d2dins_reset* e= twr_cache_malloc(sizeof(struct d2dins_reset));
+    struct d2dins_reset* e= d2d_alloc(ds, sizeof(struct d2dins_reset));
     e->hdr.type=D2D_RESET;
     set_ptrs(ds, &e->hdr, NULL, NULL); 
 }
 
 void d2d_clearrect(struct d2d_draw_seq* ds, double x, double y, double w, double h) {
-    struct d2dins_clearrect* r= twr_cache_malloc(sizeof(struct d2dins_clearrect));
+    struct d2dins_clearrect* r= d2d_alloc(ds, sizeof(struct d2dins_clearrect));
     r->hdr.type=D2D_CLEARRECT;
     r->x=x;
     r->y=y;
@@ -427,7 +450,7 @@ void d2d_clearrect(struct d2d_draw_seq* ds, double x, double y, double w, double
 }
 
 void d2d_scale(struct d2d_draw_seq* ds, double x, double y) {
-    struct d2dins_scale* r= twr_cache_malloc(sizeof(struct d2dins_scale));
+    struct d2dins_scale* r= d2d_alloc(ds, sizeof(struct d2dins_scale));
     r->hdr.type=D2D_SCALE;
     r->x=x;
     r->y=y;
@@ -435,7 +458,7 @@ void d2d_scale(struct d2d_draw_seq* ds, double x, double y) {
 }
 
 void d2d_translate(struct d2d_draw_seq* ds, double x, double y) {
-    struct d2dins_translate* r= twr_cache_malloc(sizeof(struct d2dins_translate));
+    struct d2dins_translate* r= d2d_alloc(ds, sizeof(struct d2dins_translate));
     r->hdr.type=D2D_TRANSLATE;
     r->x=x;
     r->y=y;
@@ -443,14 +466,14 @@ void d2d_translate(struct d2d_draw_seq* ds, double x, double y) {
 }
 
 void d2d_rotate(struct d2d_draw_seq* ds, double angle) {
-    struct d2dins_rotate* r= twr_cache_malloc(sizeof(struct d2dins_rotate));
+    struct d2dins_rotate* r= d2d_alloc(ds, sizeof(struct d2dins_rotate));
     r->hdr.type=D2D_ROTATE;
     r->angle=angle;
     set_ptrs(ds, &r->hdr, NULL, NULL);
 }
 
 void d2d_gettransform(struct d2d_draw_seq* ds, struct d2d_2d_matrix* transform) {
-    struct d2dins_gettransform* r = twr_cache_malloc(sizeof(struct d2dins_gettransform));
+    struct d2dins_gettransform* r = d2d_alloc(ds, sizeof(struct d2dins_gettransform));
     r->hdr.type=D2D_GETTRANSFORM;
     r->transform = transform;
     set_ptrs(ds, &r->hdr, NULL, NULL);
@@ -458,7 +481,7 @@ void d2d_gettransform(struct d2d_draw_seq* ds, struct d2d_2d_matrix* transform)
 }
 
 void d2d_settransform(struct d2d_draw_seq* ds, double a, double b, double c, double d, double e, double f) {
-    struct d2dins_settransform* r= twr_cache_malloc(sizeof(struct d2dins_settransform));
+    struct d2dins_settransform* r= d2d_alloc(ds, sizeof(struct d2dins_settransform));
     r->hdr.type=D2D_SETTRANSFORM;
     r->a = a;
     r->b = b;
@@ -473,13 +496,13 @@ void d2d_settransformmatrix(struct d2d_draw_seq* ds, const struct d2d_2d_matrix
 }
 
 void d2d_resettransform(struct d2d_draw_seq* ds) {
-    struct d2dins_resettransform* r = twr_cache_malloc(sizeof(struct d2dins_resettransform));
+    struct d2dins_resettransform* r = d2d_alloc(ds, sizeof(struct d2dins_resettransform));
     r->hdr.type=D2D_RESETTRANSFORM;
     set_ptrs(ds, &r->hdr, NULL, NULL);
 }
 
 void d2d_roundrect(struct d2d_draw_seq* ds, double x, double y, double width, double height, double radii) {
-    struct d2dins_roundrect* r = twr_cache_malloc(sizeof(struct d2dins_roundrect));
+    struct d2dins_roundrect* r = d2d_alloc(ds, sizeof(struct d2dins_roundrect));
     r->hdr.type=D2D_ROUNDRECT;
     r->x = x;
     r->y = y;
@@ -490,7 +513,7 @@ void d2d_roundrect(struct d2d_draw_seq* ds, double x, double y, double width, do
 }
 
 void d2d_ellipse(struct d2d_draw_seq* ds, double x, double y, double radiusX, double radiusY, double rotation, double startAngle, double endAngle, bool counterclockwise) {
-    struct d2dins_ellipse* r = twr_cache_malloc(sizeof(struct d2dins_ellipse));
+    struct d2dins_ellipse* r = d2d_alloc(ds, sizeof(struct d2dins_ellipse));
     r->hdr.type = D2D_ELLIPSE;
     r->x = x;
     r->y = y;
@@ -504,7 +527,7 @@ void d2d_ellipse(struct d2d_draw_seq* ds, double x, double y, double radiusX, do
 }
 
 void d2d_quadraticcurveto(struct d2d_draw_seq* ds, double cpx, double cpy, double x, double y) {
-    struct d2dins_quadraticcurveto* r = twr_cache_malloc(sizeof(struct d2dins_quadraticcurveto));
+    struct d2dins_quadraticcurveto* r = d2d_alloc(ds, sizeof(struct d2dins_quadraticcurveto));
     r->hdr.type = D2D_QUADRATICCURVETO;
     r->cpx = cpx;
     r->cpy = cpy;
@@ -514,12 +537,12 @@ void d2d_quadraticcurveto(struct d2d_draw_seq* ds, double cpx, double cpy, doubl
 }
 
 void d2d_setlinedash(struct d2d_draw_seq* ds, unsigned long len, const double* segments) {
-    struct d2dins_setlinedash* r = twr_cache_malloc(sizeof(struct d2dins_setlinedash));
+    struct d2dins_setlinedash* r = d2d_alloc(ds, sizeof(struct d2dins_setlinedash));
     r->hdr.type = D2D_SETLINEDASH;
     r->segment_len = len;
     r->segments = NULL;
     if (len > 0) {
-        r->segments = twr_cache_malloc(sizeof(double) * len);
+        r->segments = d2d_alloc(ds, sizeof(double) * len);
 
         for (int i = 0; i < len; i++) {
             r->segments[i] = segments[i];
@@ -529,7 +552,7 @@ void d2d_setlinedash(struct d2d_draw_seq* ds, unsigned long len, const double* s
 }
 
 unsigned long d2d_getlinedash(struct d2d_draw_seq* ds, unsigned long length, double* buffer) {
-    struct d2dins_getlinedash* r = twr_cache_malloc(sizeof(struct d2dins_getlinedash));
+    struct d2dins_getlinedash* r = d2d_alloc(ds, sizeof(struct d2dins_getlinedash));
     r->hdr.type = D2D_GETLINEDASH;
     r->buffer = buffer;
     r->buffer_length = length;
@@ -539,7 +562,7 @@ unsigned long d2d_getlinedash(struct d2d_draw_seq* ds, unsigned long length, dou
 }
 
 void d2d_arcto(struct d2d_draw_seq* ds, double x1, double y1, double x2, double y2, double radius) {
-    struct d2dins_arcto* r = twr_cache_malloc(sizeof(struct d2dins_arcto));
+    struct d2dins_arcto* r = d2d_alloc(ds, sizeof(struct d2dins_arcto));
     r->hdr.type = D2D_ARCTO;
     r->x1 = x1;
     r->y1 = y1;
@@ -550,7 +573,7 @@ void d2d_arcto(struct d2d_draw_seq* ds, double x1, double y1, double x2, double
 }
 
 unsigned long d2d_getlinedashlength(struct d2d_draw_seq* ds) {
-    struct d2dins_getlinedashlength* r = twr_cache_malloc(sizeof(struct d2dins_getlinedashlength));
+    struct d2dins_getlinedashlength* r = d2d_alloc(ds, sizeof(struct d2dins_getlinedashlength));
     r->hdr.type = D2D_GETLINEDASHLENGTH;
     set_ptrs(ds, &r->hdr, NULL, NULL);
     d2d_flush(ds);
@@ -565,7 +588,7 @@ bool d2d_load_image_with_con(const char* url, long id, twr_ioconsole_t * con) {
 }
 
 void d2d_drawimage_ex(struct d2d_draw_seq* ds, long id, double sx, double sy, double sWidth, double sHeight, double dx, double dy, double dWidth, double dHeight) {
-    struct d2dins_drawimage* r = twr_cache_malloc(sizeof(struct d2dins_drawimage));
+    struct d2dins_drawimage* r = d2d_alloc(ds, sizeof(struct d2dins_drawimage));
     r->hdr.type = D2D_DRAWIMAGE;
     r->id = id;
     r->sx = sx;
@@ -585,7 +608,7 @@ void d2d_drawimage(struct d2d_draw_seq* ds, long id, double dx, double dy) {
 }
 
 void d2d_rect(struct d2d_draw_seq* ds, double x, double y, double width, double height) {
-    struct d2dins_rect* r = twr_cache_malloc(sizeof(struct d2dins_rect));
+    struct d2dins_rect* r = d2d_alloc(ds, sizeof(struct d2dins_rect));
     r->hdr.type = D2D_RECT;
     r->x = x;
     r->y = y;
@@ -595,7 +618,7 @@ void d2d_rect(struct d2d_draw_seq* ds, double x, double y, double width, double
 }
 
 void d2d_transform(struct d2d_draw_seq* ds, double a, double b, double c, double d, double e, double f) {
-    struct d2dins_transform* r = twr_cache_malloc(sizeof(struct d2dins_transform));
+    struct d2dins_transform* r = d2d_alloc(ds, sizeof(struct d2dins_transform));
     r->hdr.type = D2D_TRANSFORM;
     r->a = a;
     r->b = b;
@@ -610,28 +633,28 @@ void d2d_transformmatrix(struct d2d_draw_seq* ds, const struct d2d_2d_matrix * t
 }
 
 void d2d_setlinecap(struct d2d_draw_seq* ds, const char* line_cap) {
-    struct d2dins_setlinecap* r = twr_cache_malloc(sizeof(struct d2dins_setlinecap));
+    struct d2dins_setlinecap* r = d2d_alloc(ds, sizeof(struct d2dins_setlinecap));
     r->hdr.type = D2D_SETLINECAP;
-    r->line_cap = cache_strdup(line_cap);
+    r->line_cap = d2d_strdup(ds, line_cap);
     set_ptrs(ds, &r->hdr, (void*)r->line_cap, NULL);
 }
 
 void d2d_setlinejoin(struct d2d_draw_seq* ds, const char* line_join) {
-    struct d2dins_setlinejoin* r = twr_cache_malloc(sizeof(struct d2dins_setlinejoin));
+    struct d2dins_setlinejoin* r = d2d_alloc(ds, sizeof(struct d2dins_setlinejoin));
     r->hdr.type = D2D_SETLINEJOIN;
-    r->line_join = cache_strdup(line_join);
+    r->line_join = d2d_strdup(ds, line_join);
     set_ptrs(ds, &r->hdr, (void*)r->line_join, NULL);
 }
 
 void d2d_setlinedashoffset(struct d2d_draw_seq* ds, double line_dash_offset) {
-    struct d2dins_setlinedashoffset* r = twr_cache_malloc(sizeof(struct d2dins_setlinedashoffset));
+    struct d2dins_setlinedashoffset* r = d2d_alloc(ds, sizeof(struct d2dins_setlinedashoffset));
     r->hdr.type = D2D_SETLINEDASHOFFSET;
     r->line_dash_offset = line_dash_offset;
     set_ptrs(ds, &r->hdr, NULL, NULL);
 }
 
 void d2d_getimagedata(struct d2d_draw_seq* ds, long id, double x, double y, double width, double height) {
-    struct d2dins_getimagedata* r = twr_cache_malloc(sizeof(struct d2dins_getimagedata));
+    struct d2dins_getimagedata* r = d2d_alloc(ds, sizeof(struct d2dins_getimagedata));
     r->hdr.type = D2D_GETIMAGEDATA;
     r->x = x;
     r->y = y;
@@ -652,7 +675,7 @@ unsigned long d2d_getimagedatasize(double width, double height) {
 }
 
 void d2d_imagedatatoc(struct d2d_draw_seq* ds, long id, void* buffer, unsigned long buffer_len) {
-   struct d2dins_imagedatatoc* r = twr_cache_malloc(sizeof(struct d2dins_imagedatatoc));
+   struct d2dins_imagedatatoc* r = d2d_alloc(ds, sizeof(struct d2dins_imagedatatoc));
    r->hdr.type = D2D_IMAGEDATATOC;
    r->id = id;
    r->buffer = buffer;
@@ -662,7 +685,7 @@ void d2d_imagedatatoc(struct d2d_draw_seq* ds, long id, void* buffer, unsigned l
 }
 
 double d2d_getcanvaspropdouble(struct d2d_draw_seq* ds, const char* prop_name) {
-   struct d2dins_getcanvaspropdouble* r = twr_cache_malloc(sizeof(struct d2dins_getcanvaspropdouble));
+   struct d2dins_getcanvaspropdouble* r = d2d_alloc(ds, sizeof(struct d2dins_getcanvaspropdouble));
    r->hdr.type = D2D_GETCANVASPROPDOUBLE;
    r->prop_name = prop_name;
    double ret_val;
@@ -672,7 +695,7 @@ double d2d_getcanvaspropdouble(struct d2d_draw_seq* ds, const char* prop_name) {
    return ret_val;
 }
 void d2d_getcanvaspropstring(struct d2d_draw_seq* ds, const char* prop_name, char* buffer, unsigned long buffer_len) {
-   struct d2dins_getcanvaspropstring* r = twr_cache_malloc(sizeof(struct d2dins_getcanvaspropstring));
+   struct d2dins_getcanvaspropstring* r = d2d_alloc(ds, sizeof(struct d2dins_getcanvaspropstring));
    r->hdr.type = D2D_GETCANVASPROPSTRING;
    r->prop_name = prop_name;
    r->val = buffer;
@@ -681,17 +704,17 @@ void d2d_getcanvaspropstring(struct d2d_draw_seq* ds, const char* prop_name, cha
    d2d_flush(ds);
 }
 void d2d_setcanvaspropdouble(struct d2d_draw_seq* ds, const char* prop_name, double val) {
-   struct d2dins_setcanvaspropdouble* r = twr_cache_malloc(sizeof(struct d2dins_setcanvaspropdouble));
+   struct d2dins_setcanvaspropdouble* r = d2d_alloc(ds, sizeof(struct d2dins_setcanvaspropdouble));
    r->hdr.type = D2D_SETCANVASPROPDOUBLE;
-   r->prop_name = cache_strdup(prop_name);
+   r->prop_name = d2d_strdup(ds, prop_name);
    r->val = val;
    set_ptrs(ds, &r->hdr, (void*)r->prop_name, NULL);
 }
 void d2d_setcanvaspropstring(struct d2d_draw_seq* ds, const char* prop_name, const char* val) {
-   struct d2dins_setcanvaspropstring* r = twr_cache_malloc(sizeof(struct d2dins_setcanvaspropstring));
+   struct d2dins_setcanvaspropstring* r = d2d_alloc(ds, sizeof(struct d2dins_setcanvaspropstring));
    r->hdr.type = D2D_SETCANVASPROPSTRING;
-   r->prop_name = cache_strdup(prop_name);
-   r->val = cache_strdup(val);
+   r->prop_name = d2d_strdup(ds, prop_name);
+   r->val = d2d_strdup(ds, val);
 
    set_ptrs(ds, &r->hdr, (void*)r->prop_name, (void*)r->val);
 }
\ No newline at end of file
@@ -74,6 +74,12 @@ void twr_wasm_init(int stdio_jsid, int stderr_jsid, int std2d_jsid, unsigned lon
 
 }
 
+// called by JavaScript when a call into C returns, so that output buffered by printf, etc. is displayed
+__attribute__((export_name("twr_wasm_flush")))
+void twr_wasm_flush(void) {
+	io_flush_all();
+}
+
 __attribute__((export_name("twr_wasm_print_mem_debug_stats")))
 void twr_wasm_print_mem_debug_stats(void) {
 	twr_mem_debug_stats(twr_get_stderr_con());
@@ -1,9 +1,11 @@
 #include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stddef.h>
 #include <ctype.h>
 #include <assert.h>
 #include <locale.h>
+#include <stdio.h>  // _IOFBF, _IOLBF, _IONBF
 #include <twr-jsimports.h>  // twrUnicodeCodePointToCodePage, twrCodePageToUnicodeCodePoint
 #include "twr-io.h"
 #include "twr-crt.h"  //twr_vcbprintf
@@ -24,6 +26,23 @@
  */
 
 
+//*************************************************
+
+static void put_unbuffered(twr_ioconsole_t* io, const char* str)
+{
+	if (io->charout.io_putstr) {
+		(*io->charout.io_putstr)(io, str);
+	}
+	else {
+		assert(io->charout.io_putc);
+		for (int i=0; str[i]; i++)
+			(*io->charout.io_putc)(io, str[i]);
+	}
+}
+
+// any output buffered by io_write is sent before a console is used directly, so that output stays in order
+#define FLUSH_PENDING(io) do { if ((io)->outbuf.len) io_flush(io); } while(0)
+
 //*************************************************
 
 // io_putc outputs a byte of a stream encoded in the current codepage.
@@ -32,6 +51,7 @@
 void io_putc(twr_ioconsole_t* io, unsigned char c)
 {
 	assert(io->charout.io_putc);
+	FLUSH_PENDING(io);
 	(*io->charout.io_putc)(io, c);
 }
 
@@ -39,19 +59,172 @@ void io_putc(twr_ioconsole_t* io, unsigned char c)
 
 void io_putstr(twr_ioconsole_t* io, const char* str)
 {
-	if (io->charout.io_putstr) {
-		(*io->charout.io_putstr)(io, str);
+	FLUSH_PENDING(io);
+	put_unbuffered(io, str);
+}
+
+//*************************************************
+/*
+ * Output buffering, used by the stdio functions (printf, fwrite, putc, etc).
+ *
+ * Each console has an output buffer that is sent with io_putstr, instead of making a call to the console (a JavaScript call for a jscon) per byte.
+ * Consoles that can read input or that are an addressable display (a terminal) are line buffered, other consoles are fully buffered.
+ * setvbuf (io_setvbuf) can change this. Buffered output is sent when:
+ *    - the buffer is full, or a newline is written to a line buffered console
+ *    - fflush (io_flush) is called
+ *    - the console is used directly (io_putc, io_putstr, io_cls, etc)
+ *    - input is read from any console
+ *    - the C function called from JavaScript returns or traps (twr_wasm_flush)
+ *    - abort or assert is called
+ */
+
+static twr_ioconsole_t* buffered_cons;
+
+static void buffer_init(twr_ioconsole_t* io)
+{
+	struct IoCharWriteBuffer* b=&io->outbuf;
+
+	b->buf=b->inline_buf;
+	b->size=TWR_IO_BUFSIZ;
+	b->len=0;
+	if (b->mode==0)
+		b->mode=(io->header.type&(IO_TYPE_CHARREAD|IO_TYPE_ADDRESSABLE_DISPLAY)) ? _IOLBF : _IOFBF;
+
+	b->next=buffered_cons;
+	buffered_cons=io;
+}
+
+// the number of bytes at the end of str that start an incomplete UTF-8 character
+static int utf8_incomplete_tail(const char* str, int len)
+{
+	for (int k=1; k<=3 && k<=len; k++) {
+		const unsigned char c=str[len-k];
+		if ((c&0xC0)!=0x80) {
+			const int need = c>=0xF0 ? 4 : c>=0xE0 ? 3 : c>=0xC0 ? 2 : 1;
+			return need>k ? k : 0;
+		}
+	}
+	return 0;
+}
+
+// sends all but the last 'keep' bytes of the buffer to the console
+// the bytes are sent with io_putstr, except for zero bytes, which are sent with io_putc
+static void buffer_send(twr_ioconsole_t* io, int keep)
+{
+	struct IoCharWriteBuffer* b=&io->outbuf;
+	char* str=b->buf;
+	int len=b->len-keep;
+
+	while (len>0) {
+		const char* z=memchr(str, 0, len);
+		const int n = z ? z-str : len;
+		if (n>0) {
+			const char save=str[n];  // buf has room for a terminating zero after the last byte
+			str[n]=0;
+			put_unbuffered(io, str);
+			str[n]=save;
+		}
+		if (z) {
+			(*io->charout.io_putc)(io, 0);
+			str+=n+1;
+			len-=n+1;
+		}
+		else {
+			str+=n;
+			len-=n;
+		}
+	}
+
+	if (keep) memmove(b->buf, b->buf+b->len-keep, keep);
+	b->len=keep;
+}
+
+// writes len bytes to the console's output buffer
+void io_write(twr_ioconsole_t* io, const char* str, size_t len)
+{
+	struct IoCharWriteBuffer* b=&io->outbuf;
+
+	if (b->buf==NULL) buffer_init(io);
+
+	const bool newline = b->mode==_IOLBF && memchr(str, '\n', len)!=NULL;
+
+	while (len>0) {
+		const size_t n=__min(len, (size_t)(b->size-b->len));
+		memcpy(b->buf+b->len, str, n);
+		b->len+=n;
+		str+=n;
+		len-=n;
+		if (b->len==b->size) {
+			// don't split a UTF-8 character across two io_putstr calls
+			int keep = __get_current_lc_ctype_code_page_modified()==TWR_CODEPAGE_UTF8 ? utf8_incomplete_tail(b->buf, b->len) : 0;
+			if (keep==b->len) keep=0;  // a setvbuf buffer too small to hold a character
+			buffer_send(io, keep);
+		}
+	}
+
+	if (b->len && (newline || b->mode==_IONBF))
+		buffer_send(io, 0);
+}
+
+// sends any buffered output to the console
+void io_flush(twr_ioconsole_t* io)
+{
+	if (io && io->outbuf.len)
+		buffer_send(io, 0);
+}
+
+// sends any buffered output on all consoles
+void io_flush_all(void)
+{
+	for (twr_ioconsole_t* io=buffered_cons; io; io=io->outbuf.next)
+		io_flush(io);
+}
+
+// sets the buffering mode (_IOFBF, _IOLBF, or _IONBF) and optionally the buffer (see setvbuf)
+// if buf is NULL, the console's own buffer is used
+// returns 0 on success, or non zero if the mode or size is invalid
+int io_setvbuf(twr_ioconsole_t* io, char* buf, int mode, size_t size)
+{
+	if (mode!=_IOFBF && mode!=_IOLBF && mode!=_IONBF) return -1;
+	if (buf && size<2) return -1;
+
+	struct IoCharWriteBuffer* b=&io->outbuf;
+
+	if (b->buf==NULL) buffer_init(io);
+	else io_flush(io);
+
+	b->mode=mode;
+	if (buf) {
+		b->buf=buf;
+		b->size=size-1;  // leave room for a terminating zero
 	}
 	else {
-		for (int i=0; str[i]; i++)
-			io_putc(io, str[i]);
+		b->buf=b->inline_buf;
+		b->size=TWR_IO_BUFSIZ;
+	}
+
+	return 0;
+}
+
+static void buffer_close(twr_ioconsole_t* io)
+{
+	if (io->outbuf.buf==NULL) return;
+
+	io_flush(io);
+	for (twr_ioconsole_t** p=&buffered_cons; *p; p=&(*p)->outbuf.next) {
+		if (*p==io) {
+			*p=io->outbuf.next;
+			break;
+		}
 	}
+	io->outbuf.buf=NULL;
 }
 
 //*************************************************
 
 char io_inkey(twr_ioconsole_t* io)
 {
+	io_flush_all();
 	if (io->charin.io_inkey)
 		return (*io->charin.io_inkey)(io);
 	else
@@ -72,6 +245,7 @@ void io_setfocus(twr_ioconsole_t* io)
 // console must support IO_TYPE_CHARREAD
 int io_getc32(twr_ioconsole_t* io)
 {
+	io_flush_all();
 	if (*io->charin.io_getc32)
 		return (*io->charin.io_getc32)(io);
 	else
@@ -147,6 +321,7 @@ int io_chk_brk(twr_ioconsole_t* io)
 
 void io_close(twr_ioconsole_t* io)
 {
+	buffer_close(io);
 	if (io->header.io_close)
 		io->header.io_close(io);
 }
@@ -164,6 +339,7 @@ int io_get_prop(twr_ioconsole_t* io, const char* key)
 //*************************************************
 void io_cls(twr_ioconsole_t* io)
 {
+	FLUSH_PENDING(io);
 	if (io->display.io_cls)
 		io->display.io_cls(io);
 }
@@ -189,6 +365,7 @@ bool io_setc(twr_ioconsole_t* io, int location, unsigned char c)
 //*************************************************
 /* c is a unicode 32 codepoint */
 void io_setc32(twr_ioconsole_t* io, int location, int c32) {
+	FLUSH_PENDING(io);
 	if (io->display.io_setc32)
 		io->display.io_setc32(io, location, c32);
 }
@@ -196,6 +373,7 @@ void io_setc32(twr_ioconsole_t* io, int location, int c32) {
 //*************************************************
 
 void io_setreset(twr_ioconsole_t* io, int x, int y, bool isset) {
+	FLUSH_PENDING(io);
 	if (io->display.io_setreset)
 		io->display.io_setreset(io, x, y, isset);
 }
@@ -215,6 +393,7 @@ bool io_point(twr_ioconsole_t* io, int x, int y)
 
 void io_set_cursor(twr_ioconsole_t* io, int position)
 {
+	FLUSH_PENDING(io);
 	if (io->display.io_set_cursor)
 		io->display.io_set_cursor(io, position);
 }
@@ -222,6 +401,7 @@ void io_set_cursor(twr_ioconsole_t* io, int position)
 //*************************************************
 
 void io_set_cursorxy(twr_ioconsole_t* io, int x, int y) {
+   FLUSH_PENDING(io);
    io->display.io_set_cursor(io, io->display.width*y+x); 
 }
 
@@ -229,6 +409,7 @@ void io_set_cursorxy(twr_ioconsole_t* io, int x, int y) {
 
 int io_get_cursor(twr_ioconsole_t* io)
 {
+	FLUSH_PENDING(io);
 	return io->header.io_get_prop(io, "cursorPos");
 }
 
@@ -251,6 +432,7 @@ int io_get_height(twr_ioconsole_t* io) {
 void io_set_colors(twr_ioconsole_t* io, unsigned long foreground, unsigned long background) {
 	assert(io->header.type&IO_TYPE_ADDRESSABLE_DISPLAY);  // currently only works on WindowConsole
 
+	FLUSH_PENDING(io);
    io->display.io_set_colors(io, foreground, background); 
 }
 
@@ -267,6 +449,7 @@ void io_get_colors(twr_ioconsole_t* io, unsigned long *foreground, unsigned long
 
 void io_set_range(twr_ioconsole_t* io, int *chars32, int start, int len)
 {
+	FLUSH_PENDING(io);
 	io->display.io_set_range(io, chars32, start, len);
 }
 
@@ -15,8 +15,77 @@ extern "C" {
 
 void twr_init_malloc(void* memp, size_t size_in_bytes);
 void twr_malloc_debug_stats(twr_ioconsole_t* outcon);
+void twr_malloc_thread_flush(void);
+
+// live_by_size_class[i] counts allocations of up to 8<<i bytes (more than the previous class), with the last class counting all larger allocations
+#define TWR_HEAP_STATS_SIZE_CLASSES 16
+struct twr_heap_stats {
+	double fragmentation;        // 1 - largest_free_run/free_bytes
+	size_t heap_size;            // bytes
+	size_t free_bytes;           // same as avail()
+	size_t largest_free_run;     // bytes
+	int profiling;               // if false, the following are zero
+	size_t live_bytes;           // bytes in allocations (rounded up to the 8 byte allocation unit, not including malloc's header)
+	size_t peak_live_bytes;
+	size_t live_allocations;
+	size_t total_allocations;    // since twr_heap_profile(true)
+	size_t total_frees;
+	size_t live_by_size_class[TWR_HEAP_STATS_SIZE_CLASSES];
+	size_t large_segments;       // allocations of more than 64KB are made in large object segments, with 4KB pages
+	size_t large_space_bytes;    // bytes of pages in the segments (the segments are taken from the heap)
+	size_t large_free_bytes;     // bytes of free pages in the segments
+	size_t large_allocations;    // live allocations in the segments
+};
+void twr_heap_profile(bool enable);
+void twr_heap_stats(struct twr_heap_stats* stats);
+struct twr_heap_stats* twr_heap_stats_static(void);
 void *twr_cache_malloc(size_t size);
 void twr_cache_free(void* mem);
+size_t twr_cache_trim(void);
+
+typedef uint32_t twr_handle_t;
+twr_handle_t twr_halloc(size_t size);
+void* twr_hlock(twr_handle_t h);
+void twr_hunlock(twr_handle_t h);
+void twr_hfree(twr_handle_t h);
+size_t twr_heap_compact(void);
+
+// called when malloc runs out of memory, with the size of the allocation.  Returns the number of bytes it freed.
+typedef size_t (*twr_memory_pressure_handler_t)(size_t size);
+bool twr_register_memory_pressure_handler(twr_memory_pressure_handler_t handler);
+void twr_unregister_memory_pressure_handler(twr_memory_pressure_handler_t handler);
+
+typedef struct twr_arena twr_arena_t;
+typedef struct { void* block; size_t used; } twr_arena_mark_t;
+twr_arena_t* twr_arena_create(size_t block_size);
+void* twr_arena_alloc(twr_arena_t* arena, size_t size);
+void twr_arena_reset(twr_arena_t* arena);
+twr_arena_mark_t twr_arena_mark(twr_arena_t* arena);
+void twr_arena_rewind(twr_arena_t* arena, twr_arena_mark_t mark);
+void twr_arena_destroy(twr_arena_t* arena);
+
+uint32_t murmur3_32(const uint8_t* key, size_t len, uint32_t seed);
+
+typedef struct twr_hashmap twr_hashmap_t;
+typedef uint32_t (*twr_hashmap_hash_t)(const void* key);
+typedef bool (*twr_hashmap_equal_t)(const void* a, const void* b);
+twr_hashmap_t* twr_hashmap_create(twr_hashmap_hash_t hash, twr_hashmap_equal_t equal, twr_arena_t* arena);
+twr_hashmap_t* twr_hashmap_create_str(twr_arena_t* arena);
+twr_hashmap_t* twr_hashmap_create_int(twr_arena_t* arena);
+void twr_hashmap_destroy(twr_hashmap_t* map);
+void twr_hashmap_clear(twr_hashmap_t* map);
+size_t twr_hashmap_count(twr_hashmap_t* map);
+bool twr_hashmap_reserve(twr_hashmap_t* map, size_t count);
+bool twr_hashmap_put(twr_hashmap_t* map, const void* key, void* value);
+bool twr_hashmap_get(twr_hashmap_t* map, const void* key, void** value);
+bool twr_hashmap_remove(twr_hashmap_t* map, const void* key);
+bool twr_hashmap_next(twr_hashmap_t* map, size_t* pos, const void** key, void** value);
+bool twr_hashmap_put_str(twr_hashmap_t* map, const char* key, void* value);
+void* twr_hashmap_get_str(twr_hashmap_t* map, const char* key);
+bool twr_hashmap_remove_str(twr_hashmap_t* map, const char* key);
+bool twr_hashmap_put_int(twr_hashmap_t* map, intptr_t key, void* value);
+void* twr_hashmap_get_int(twr_hashmap_t* map, intptr_t key);
+bool twr_hashmap_remove_int(twr_hashmap_t* map, intptr_t key);
 
 void twr_mem_debug_stats(twr_ioconsole_t* outcon);
 
@@ -25,14 +94,20 @@ void twr_strhorizflip(char * buffer, int n);
 double twr_nanval(void);
 double twr_infval(void);
 
+// does not use locale information; it always uses . (a dot) as the decimal separator.
+// twr_localize_numeric_string() is available to convert buffer if needed
 void twr_dtoa(char* buffer, int sizeInBytes, double value, int max_precision);
 int64_t twr_atou64(const char *str, int* len, int radix);
 int __atosign(const char *str, int* len);
 int __atosign_l(const char *str, int* len, locale_t loc);
+const char* __skipspace_l(const char *str, locale_t loc);
+uint64_t __atoint_width(const char *str, char **str_end, int base, int width, int* sign, bool* overflow);
 #define twr_atod(str) atof(str)
 
 typedef void (*twr_vcbprintf_callback)(void* cbdata, unsigned char c);
 void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format, va_list vlist);
+typedef void (*twr_vcbprintf_span_callback)(void* cbdata, const char* str, size_t len);
+void twr_vcbprintf_span(twr_vcbprintf_span_callback out, void* cbdata, const char *format, va_list vlist);
 void twr_conlog(const char* format, ...);
 
 twr_ioconsole_t* twr_jscon(int jsid);
@@ -59,15 +134,19 @@ __attribute__((import_name("twr_timer_repeat"))) int twr_timer_repeat(int milliS
 __attribute__((import_name("twr_timer_cancel"))) void twr_timer_cancel(int timerID);
 
 // does not use locale information; it always uses . (a dot) as the decimal separator.
-__attribute__((import_name("twrToFixed"))) double twr_tofixed(char* buffer, int buffer_size, double value, int dec_digits);
+void twr_tofixed(char* buffer, int buffer_size, double value, int dec_digits);
 
 // does not use locale information; it always uses . (a dot) as the decimal separator.
-__attribute__((import_name("twrToExponential"))) void twr_toexponential(char* buffer, int buffer_size, double value, int dec_digits);
+void twr_toexponential(char* buffer, int buffer_size, double value, int dec_digits);
 
 const char* twr_get_navlang(int *len);
 
 int twr_utf8_char_len(const char *str);
 size_t twr_mbslen_l(const char *str, locale_t locale);
+bool twr_utf8_validate(const char* str, size_t len);
+size_t twr_utf8_count(const char* str, size_t len);
+size_t twr_utf8_to_utf32(const char* str, size_t len, int* out);
+size_t twr_utf32_to_utf8(const int* str, size_t len, char* out);
 void twr_utf32_to_code_page(char*out, int utf32);
 int twr_code_page_to_utf32_streamed(unsigned char byte);
 void twr_localize_numeric_string(char* str, locale_t locale);
@@ -80,7 +159,10 @@ void __nstrcopy(char *buffer, const int sizeInBytes, const char *outstring, cons
 
 /* unit tests */
 int malloc_unit_test(void);
+int arena_unit_test(void);
+int hashmap_unit_test(void);
 int string_unit_test(void);
+int qsort_unit_test(void);
 int mbstring_unit_test(void);
 int char_unit_test(void);
 int rand_unit_test(void);
@@ -411,6 +411,7 @@ struct d2d_draw_seq {
     bool last_strokestyle_color_valid;
     double last_line_width;
     twr_ioconsole_t* con;
+    struct twr_arena* arena;  // instruction storage
 };
 
 struct d2d_text_metrics {
@@ -63,11 +63,26 @@ struct IoDisplay {
    void (*io_set_range)(twr_ioconsole_t *, int *chars32, int start, int len);
 };
 
+// size of the output buffer used by io_write (the stdio functions), unless replaced with setvbuf
+#define TWR_IO_BUFSIZ 1024
+
+// output buffer used by io_write. buf is NULL until first use.
+// mode is _IOFBF, _IOLBF, or _IONBF, or 0 if not yet set (see stdio.h)
+struct IoCharWriteBuffer {
+   char* buf;
+   int size;   // number of bytes buf can hold, not including a terminating zero
+   int len;
+   int mode;
+   twr_ioconsole_t* next;   // list of consoles with an output buffer in use
+   char inline_buf[TWR_IO_BUFSIZ+1];
+};
+
 struct IoConsole {
    struct IoConsoleHeader header;  	
    struct IoCharRead charin;  			
    struct IoCharWrite charout;	
    struct IoDisplay display;
+   struct IoCharWriteBuffer outbuf;
 };
 
 // Private Use Area (BMP - Basic Multilingual Plane)
@@ -105,6 +120,10 @@ twr_ioconsole_t* io_nullcon(void);
 int io_get_prop(twr_ioconsole_t *, const char* key);
 void io_putc(twr_ioconsole_t* io, unsigned char c);
 void io_putstr(twr_ioconsole_t* io, const char* s);
+void io_write(twr_ioconsole_t* io, const char* str, size_t len);
+void io_flush(twr_ioconsole_t* io);
+void io_flush_all(void);
+int io_setvbuf(twr_ioconsole_t* io, char* buf, int mode, size_t size);
 char io_inkey(twr_ioconsole_t* io);
 void io_setfocus(twr_ioconsole_t* io);
 int io_chk_brk(twr_ioconsole_t* io);
@@ -40,12 +40,6 @@ __attribute__((import_name("twrPow"))) double twrPow(double base, double exponen
 __attribute__((import_name("twrSqrt"))) double twrSqrt(double arg);
 __attribute__((import_name("twrTrunc"))) double twrTrunc(double arg);
 
-__attribute__((import_name("twrAtod"))) double twrAtod(const char* str, int len);
-
-// does not use locale information; it always uses . (a dot) as the decimal separator.
-// twr_localize_numeric_string() is available to convert buffer if needed
-__attribute__((import_name("twrDtoa"))) void twr_dtoa(char* buffer, int buffer_size, double value, int max_precision);
-
 #ifdef __cplusplus
 }
 #endif
@@ -31,12 +31,18 @@ int main() {
 
     if (malloc_unit_test()==0)
         printf("malloc unit test failed\n");
+    if (arena_unit_test()==0)
+        printf("arena unit test failed\n");
+    if (hashmap_unit_test()==0)
+        printf("hashmap unit test failed\n");
     if (locale_unit_test()==0)
         printf("locale unit test failed\n");
     if (char_unit_test()==0)
         printf("char unit test failed\n");
     if (string_unit_test()==0)
         printf("string unit test failed\n");
+    if (qsort_unit_test()==0)
+        printf("qsort unit test failed\n");
     if (twr_rand_unit_test()==0)
         printf("rand unit test failed\n");
     if (misc_unit_test()==0)
@@ -2,6 +2,7 @@
 #include "twr-crt.h"  //twr_trap
 
 _Noreturn void abort(void) {
+	io_flush_all();  // send buffered output (printf, etc.) before the trap
 	twr_trap();
 }
 
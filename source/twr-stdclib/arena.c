@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "twr-crt.h"
+
+/* An arena allocates by bumping a pointer in large blocks obtained from malloc.  Individual allocations are not freed,  */
+/* instead the entire arena is reset (or rewound to a mark) at once.  Blocks are kept when reset, so that an arena that is */
+/* reset every frame (or request) stops calling malloc once it has grown to the frame's size. */
+
+#define ARENA_ALIGN 8
+#define ARENA_DEFAULT_BLOCK_SIZE (16*1024)
+
+struct twr_arena_block {
+	struct twr_arena_block *next;
+	size_t size;   // bytes available after the block header
+	size_t used;
+	uint64_t pad;  // keeps the block data 8 byte aligned on 32 and 64 bit
+	// arena memory goes here
+};
+
+struct twr_arena {
+	struct twr_arena_block *first;
+	struct twr_arena_block *current;
+	size_t block_size;
+};
+
+static struct twr_arena_block* arena_new_block(size_t size) {
+	struct twr_arena_block* b=malloc(sizeof(struct twr_arena_block)+size);
+	if (b==NULL) return NULL;
+	b->next=NULL;
+	b->size=size;
+	b->used=0;
+	return b;
+}
+
+twr_arena_t* twr_arena_create(size_t block_size) {
+	assert((sizeof(struct twr_arena_block)&(ARENA_ALIGN-1))==0);
+
+	if (block_size==0) block_size=ARENA_DEFAULT_BLOCK_SIZE;
+	block_size=(block_size+ARENA_ALIGN-1)&~(size_t)(ARENA_ALIGN-1);
+
+	twr_arena_t* arena=malloc(sizeof(twr_arena_t));
+	if (arena==NULL) return NULL;
+
+	arena->block_size=block_size;
+	arena->first=arena_new_block(block_size);
+	if (arena->first==NULL) {
+		free(arena);
+		return NULL;
+	}
+	arena->current=arena->first;
+
+	return arena;
+}
+
+// returns 8 byte aligned memory that remains valid until the arena is reset, rewound to an earlier mark, or destroyed
+void* twr_arena_alloc(twr_arena_t* arena, size_t size) {
+	assert(arena);
+
+	size=(size+ARENA_ALIGN-1)&~(size_t)(ARENA_ALIGN-1);
+	struct twr_arena_block* b=arena->current;
+
+	if (size > b->size-b->used) {
+		// use the following block if it was kept by a reset and is big enough, otherwise insert a new block
+		if (b->next && size <= b->next->size) {
+			b=b->next;
+			b->used=0;
+		}
+		else {
+			struct twr_arena_block* nb=arena_new_block(size>arena->block_size?size:arena->block_size);
+			if (nb==NULL) return NULL;
+			nb->next=b->next;
+			b->next=nb;
+			b=nb;
+		}
+		arena->current=b;
+	}
+
+	void* mem=(unsigned char*)(&b[1])+b->used;
+	b->used+=size;
+	return mem;
+}
+
+// release every allocation, but keep the blocks for reuse
+void twr_arena_reset(twr_arena_t* arena) {
+	assert(arena);
+	arena->current=arena->first;
+	arena->first->used=0;
+}
+
+twr_arena_mark_t twr_arena_mark(twr_arena_t* arena) {
+	assert(arena);
+	twr_arena_mark_t mark;
+	mark.block=arena->current;
+	mark.used=arena->current->used;
+	return mark;
+}
+
+// release the allocations made since 'mark' was taken
+void twr_arena_rewind(twr_arena_t* arena, twr_arena_mark_t mark) {
+	assert(arena && mark.block);
+	arena->current=mark.block;
+	arena->current->used=mark.used;
+}
+
+void twr_arena_destroy(twr_arena_t* arena) {
+	if (arena==NULL) return;
+
+	struct twr_arena_block* b=arena->first;
+	while (b) {
+		struct twr_arena_block* next=b->next;
+		free(b);
+		b=next;
+	}
+	free(arena);
+}
+
+/************************************************/
+
+int arena_unit_test(void) {
+	const size_t sz=avail();
+
+	twr_arena_t* arena=twr_arena_create(256);
+	if (arena==NULL) return 0;
+
+	// allocations are aligned and don't overlap
+	unsigned char* p[40];
+	for (int i=0; i<40; i++) {
+		p[i]=twr_arena_alloc(arena, i+1);
+		if (p[i]==NULL || ((uintptr_t)p[i]&(ARENA_ALIGN-1))!=0) return 0;
+		memset(p[i], i, i+1);
+	}
+	for (int i=0; i<40; i++)
+		for (int k=0; k<=i; k++)
+			if (p[i][k]!=i) return 0;
+
+	// larger than the block size
+	unsigned char* big=twr_arena_alloc(arena, 1000);
+	if (big==NULL) return 0;
+	memset(big, 0xAB, 1000);
+	if (p[39][39]!=39) return 0;
+
+	// reset keeps the blocks, so the same allocations use the same memory without calling malloc
+	const size_t after_first=avail();
+	twr_arena_reset(arena);
+	for (int i=0; i<40; i++)
+		if (twr_arena_alloc(arena, i+1)!=p[i]) return 0;
+	if (avail()!=after_first) return 0;
+
+	// rewind releases what was allocated after the mark
+	twr_arena_reset(arena);
+	twr_arena_alloc(arena, 16);
+	twr_arena_mark_t mark=twr_arena_mark(arena);
+	void* m1=twr_arena_alloc(arena, 200);
+	twr_arena_alloc(arena, 200);
+	twr_arena_rewind(arena, mark);
+	if (twr_arena_alloc(arena, 200)!=m1) return 0;
+
+	twr_arena_destroy(arena);
+	if (avail()!=sz) return 0;
+
+	return 1;
+}
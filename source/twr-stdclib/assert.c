@@ -6,6 +6,7 @@
 // assert.h calls this function.  
 // normally implemented by libgcc or twr.a or similar
 void _assert (const char *_Message, const char *_File, unsigned _Line) {
+    io_flush_all();  // so buffered output printed before the assert comes before the assert message
     io_printf(stderr, "assert in file %s at line %d. ", _File, _Line);
     if (_Message) io_putstr(stderr, _Message);
     io_putc(stderr, '\n');
@@ -4,6 +4,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <errno.h>
 #include "twr-crt.h"
 
 static int detect_base(const char* str, int * len) {
@@ -24,13 +25,23 @@ int __atosign(const char *str, int* len) {
 	return __atosign_l(str, len, twr_get_current_locale());
 }
 
+// the C and UTF-8 locales only have ASCII white space, so for them the locale is checked once, instead of once per character
+const char* __skipspace_l(const char *str, locale_t loc) {
+	const struct lconv* lcc=__get_lconv_lc_ctype(loc);
+	if (__is_c_locale(lcc) || __is_utf8_locale(lcc)) {
+		while (*str==' ' || (*str>='\t' && *str<='\r')) str++;
+	}
+	else {
+		while (isspace_l((unsigned char)*str, loc)) str++;
+	}
+	return str;
+}
+
 int __atosign_l(const char *str, int* len, locale_t loc) {
 	int sign=1;
 
-	*len=0;
-
 	/** ignore leading space */
-	while (isspace_l(str[*len], loc)) (*len)++;
+	*len=__skipspace_l(str, loc)-str;
 
 	/** get optional sign */
 	if (str[*len]=='+') (*len)++;
@@ -92,6 +103,55 @@ long long atoll(const char *str) {
 	return sign*value;
 }
 
+// used by strtoll_l, strtoull_l, and the scanf family (which can limit the number of characters read with a field width)
+// parses [sign][0x or 0X]digits, reading at most width characters.  Leading white space must already be skipped.
+// a 0x prefix is only used if a hex digit follows it.  digits are ASCII in all locales, so no locale is needed.
+// returns the magnitude, or UINT64_MAX and sets *overflow if it doesn't fit.  If there are no digits, *str_end is set to str.
+uint64_t __atoint_width(const char *str, char **str_end, int base, int width, int* sign, bool* overflow) {
+	assert(base==0 || (base>=2 && base<=36));
+	const char* p=str;
+
+	*sign=1;
+	*overflow=false;
+
+	if (width>0 && (*p=='+' || *p=='-')) {
+		if (*p=='-') *sign=-1;
+		p++;
+		width--;
+	}
+
+	if ((base==0 || base==16) && width>=3 && p[0]=='0' && (p[1]=='x' || p[1]=='X') && char_to_int(p[2])!=-1 && char_to_int(p[2])<16) {
+		base=16;
+		p+=2;
+		width-=2;
+	}
+	else if (base==0) {
+		base = *p=='0' ? 8 : 10;
+	}
+
+	const char* const digits=p;
+	const uint64_t cutoff=UINT64_MAX/base;
+	const int cutlim=(int)(UINT64_MAX%base);
+	uint64_t value=0;
+
+	for (; width>0; p++, width--) {
+		const int d=char_to_int(*p);
+		if (d==-1 || d>=base) break;
+		if (value>cutoff || (value==cutoff && d>cutlim))
+			*overflow=true;
+		else
+			value=value*base+d;
+	}
+
+	if (p==digits) {
+		*str_end=(char*)str;
+		return 0;
+	}
+
+	*str_end=(char*)p;
+	return *overflow ? UINT64_MAX : value;
+}
+
 //If successful, an integer value corresponding to the contents of str is returned.
 //If the converted value falls out of range of corresponding return type, a range error occurs (setting errno to ERANGE) and LONG_MAX, LONG_MIN, LLONG_MAX or LLONG_MIN is returned.
 //If no conversion can be performed, ​0​ is returned.
@@ -100,26 +160,24 @@ long long strtoll_l(const char *str, char **str_end, int base,  locale_t loc) {
 	assert(str);
 	if (str==NULL) return 0;
 
-	if (*str==0) {
-		if (str_end) *str_end=(char*)str;
-		return 0;
-	}
+	const char* p=__skipspace_l(str, loc);
+	char* end;
+	int sign;
+	bool overflow;
+	const uint64_t value=__atoint_width(p, &end, base, INT_MAX, &sign, &overflow);
 
-	int len;
-	int sign=__atosign_l(str, &len, loc);
-	char*p = (char*)str+len;
+	if (str_end) *str_end = end==p ? (char*)str : end;
 
-	if (base==0) {  // auto detect
-		base=detect_base(p, &len);
-		p=p+len;
+	if (sign>0 && value>(uint64_t)LLONG_MAX) {
+		errno=ERANGE;
+		return LLONG_MAX;
+	}
+	if (sign<0 && value>(uint64_t)LLONG_MAX+1) {
+		errno=ERANGE;
+		return LLONG_MIN;
 	}
 
-	long long retval=(long long)twr_atou64(p, &len, base);
-	p=p+len;
-
-	if (str_end) *str_end=(char *)p;
-
-	return sign*retval;
+	return sign<0 ? (long long)(0-value) : (long long)value;
 }
 
 long long strtoll(const char *str, char **str_end, int base) {
@@ -135,26 +193,20 @@ unsigned long long strtoull_l(const char *str, char **str_end,  int base, locale
 	assert(str);
 	if (str==NULL) return 0;
 
-	if (*str==0) {
-		if (str_end) *str_end=(char*)str;
-		return 0;
-	}
+	const char* p=__skipspace_l(str, loc);
+	char* end;
+	int sign;
+	bool overflow;
+	const uint64_t value=__atoint_width(p, &end, base, INT_MAX, &sign, &overflow);
 
-	int len;
-	int sign=__atosign_l(str, &len, loc);
-	char*p = (char*)str+len;
+	if (str_end) *str_end = end==p ? (char*)str : end;
 
-	if (base==0) {  // auto detect
-		base=detect_base(p, &len);
-		p=p+len;
+	if (overflow) {
+		errno=ERANGE;
+		return ULLONG_MAX;
 	}
 
-	unsigned long long retval=(unsigned long long)twr_atou64(p, &len, base);
-	p=p+len;
-
-	if (str_end) *str_end=(char *)p;
-
-	return (unsigned long long)(sign*retval);	
+	return sign<0 ? 0-value : value;
 }
 
 unsigned long long strtoull(const char *str, char **str_end,  int base) {
@@ -312,6 +364,41 @@ int cvtint_unit_test() {
 	rull=strtoull(x, &end, 0);
 	if (rull!=1152921504606846977 && end!=x+19) return 0;
 
+	x=" -";
+	rll=strtoll(x, &end, 10);
+	if (rll!=0 || end!=x) return 0;
+
+	x="0xz";
+	rll=strtoll(x, &end, 0);
+	if (rll!=0 || end!=x+1) return 0;
+
+	x="0x1f";
+	rll=strtoll(x, &end, 16);
+	if (rll!=31 || end!=x+4) return 0;
+
+	errno=0;
+	x="9223372036854775808";
+	rll=strtoll(x, &end, 10);
+	if (rll!=LLONG_MAX || errno!=ERANGE || end!=x+19) return 0;
+
+	errno=0;
+	rll=strtoll("-9223372036854775809", &end, 10);
+	if (rll!=LLONG_MIN || errno!=ERANGE) return 0;
+
+	errno=0;
+	rull=strtoull("18446744073709551616", &end, 10);
+	if (rull!=ULLONG_MAX || errno!=ERANGE) return 0;
+
+	int sign;
+	bool overflow;
+	x="-12345";
+	rull=__atoint_width(x, &end, 10, 3, &sign, &overflow);
+	if (rull!=12 || sign!=-1 || overflow || end!=x+3) return 0;
+
+	x="0x7";
+	rull=__atoint_width(x, &end, 16, 2, &sign, &overflow);  // the width leaves no room for a digit after 0x
+	if (rull!=0 || end!=x+1) return 0;
+
 	if (atoi("  +0005")!=5) return 0;
 	if (atoi("499")!=499) return 0;
 	if (atoi("-500")!=-500) return 0;	
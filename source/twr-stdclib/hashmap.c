@@ -0,0 +1,512 @@
+#include <stdint.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>  // snprintf, for the unit test
+#include "twr-crt.h"
+
+/* twr_hashmap is an open addressing hash table, organized like SwissTable.  The slots are in groups of 16, and each slot  */
+/* has a control byte that is EMPTY, DELETED, or the low 7 bits of the key's hash.  A lookup compares a group's 16 control */
+/* bytes to the hash bits at once (with -msimd128, a single vector compare), and only calls the key compare function for */
+/* slots that match.  A lookup ends at the first group that has an EMPTY slot. */
+
+#define GROUP_SIZE 16
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+#define HASH_SEED 0x9747b28c
+
+struct twr_hashmap_slot {
+	const void* key;
+	void* value;
+};
+
+struct twr_hashmap {
+	unsigned char* ctrl;   // num_groups*GROUP_SIZE control bytes
+	struct twr_hashmap_slot* slots;
+	size_t num_groups;     // a power of 2, or 0 before the first put
+	size_t count;
+	size_t growth_left;    // EMPTY slots that can be used before the table is over 7/8 full
+	twr_hashmap_hash_t hash;
+	twr_hashmap_equal_t equal;
+	twr_arena_t* arena;    // if not NULL, all memory comes from the arena
+	enum {KEYS_CUSTOM, KEYS_STR, KEYS_INT} keys;   // KEYS_STR keys are copied on put, and owned by the map
+};
+
+/************************************************/
+
+// a group mask has bit i set for slot i of a group
+
+#ifdef __wasm_simd128__
+typedef unsigned char __u8x16 __attribute__((vector_size(16), aligned(16), __may_alias__));
+typedef signed char __i8x16 __attribute__((vector_size(16), aligned(16)));
+struct __u8x16_unaligned { __u8x16 v; } __attribute__((packed, __may_alias__));
+
+static inline uint32_t group_match(const unsigned char* ctrl, unsigned char h2) {
+	const __u8x16 zero={0};
+	return (uint32_t)__builtin_wasm_bitmask_i8x16((__i8x16)(((const struct __u8x16_unaligned*)ctrl)->v==zero+h2));
+}
+
+static inline uint32_t group_match_empty(const unsigned char* ctrl) {
+	return group_match(ctrl, CTRL_EMPTY);
+}
+
+// EMPTY and DELETED are the control bytes with the high bit set
+static inline uint32_t group_match_empty_or_deleted(const unsigned char* ctrl) {
+	return (uint32_t)__builtin_wasm_bitmask_i8x16((__i8x16)((const struct __u8x16_unaligned*)ctrl)->v);
+}
+
+#else
+#define LSB_64 0x0101010101010101ULL
+#define MSB_64 0x8080808080808080ULL
+
+static inline uint64_t load8(const unsigned char* p) {
+	uint64_t w;
+	memcpy(&w, p, 8);
+	return w;
+}
+
+// gathers the high bit of each byte into an 8 bit mask
+static inline uint32_t high_bits_to_mask(uint64_t w) {
+	return (uint32_t)((((w&MSB_64)>>7)*0x0102040810204080ULL)>>56);
+}
+
+// may report a false match for a byte that follows a match, which is harmless since the keys are compared
+static inline uint32_t match8(uint64_t w, unsigned char h2) {
+	const uint64_t x=w^(LSB_64*h2);
+	return high_bits_to_mask((x-LSB_64)&~x);
+}
+
+// EMPTY (0x80) is the only control byte with the high bit set and bit 1 clear
+static inline uint32_t empty8(uint64_t w) {
+	return high_bits_to_mask(w&~(w<<6));
+}
+
+static inline uint32_t group_match(const unsigned char* ctrl, unsigned char h2) {
+	return match8(load8(ctrl), h2) | match8(load8(ctrl+8), h2)<<8;
+}
+
+static inline uint32_t group_match_empty(const unsigned char* ctrl) {
+	return empty8(load8(ctrl)) | empty8(load8(ctrl+8))<<8;
+}
+
+static inline uint32_t group_match_empty_or_deleted(const unsigned char* ctrl) {
+	return high_bits_to_mask(load8(ctrl)) | high_bits_to_mask(load8(ctrl+8))<<8;
+}
+#endif
+
+/************************************************/
+
+static void* map_alloc(twr_hashmap_t* map, size_t size) {
+	return map->arena ? twr_arena_alloc(map->arena, size) : malloc(size);
+}
+
+static void map_free(twr_hashmap_t* map, void* mem) {
+	if (map->arena==NULL) free(mem);
+}
+
+static uint32_t hash_str(const void* key) {
+	return murmur3_32((const uint8_t*)key, strlen(key), HASH_SEED);
+}
+
+static bool equal_str(const void* a, const void* b) {
+	return strcmp(a, b)==0;
+}
+
+static uint32_t hash_int(const void* key) {
+	const intptr_t k=(intptr_t)key;
+	return murmur3_32((const uint8_t*)&k, sizeof(k), HASH_SEED);
+}
+
+static bool equal_int(const void* a, const void* b) {
+	return a==b;
+}
+
+// the string and integer helpers are called directly, rather than through the function pointers, so they can be inlined
+static inline uint32_t map_hash(const twr_hashmap_t* map, const void* key) {
+	switch (map->keys) {
+		case KEYS_STR: return hash_str(key);
+		case KEYS_INT: return hash_int(key);
+		default: return map->hash(key);
+	}
+}
+
+static inline bool map_equal(const twr_hashmap_t* map, const void* a, const void* b) {
+	switch (map->keys) {
+		case KEYS_STR: return equal_str(a, b);
+		case KEYS_INT: return equal_int(a, b);
+		default: return map->equal(a, b);
+	}
+}
+
+static size_t max_load(size_t num_groups) {
+	return num_groups*GROUP_SIZE-num_groups*GROUP_SIZE/8;
+}
+
+// returns the group and slot that hold key, or -1
+static intptr_t find_slot(const twr_hashmap_t* map, const void* key, uint32_t hash) {
+	if (map->num_groups==0) return -1;
+
+	const size_t group_mask=map->num_groups-1;
+	const unsigned char h2=hash&0x7F;
+	size_t g=(hash>>7)&group_mask;
+
+	// triangular probing visits every group once, since the number of groups is a power of 2
+	for (size_t step=1; step<=map->num_groups; step++) {
+		const unsigned char* ctrl=map->ctrl+g*GROUP_SIZE;
+		for (uint32_t match=group_match(ctrl, h2); match; match&=match-1) {
+			const size_t i=g*GROUP_SIZE+__builtin_ctz(match);
+			if (map->ctrl[i]==h2 && map_equal(map, map->slots[i].key, key)) return i;
+		}
+		if (group_match_empty(ctrl)) return -1;
+		g=(g+step)&group_mask;
+	}
+
+	return -1;
+}
+
+// returns the first EMPTY or DELETED slot on key's probe sequence.  The table must have a free slot.
+static size_t find_free_slot(const twr_hashmap_t* map, uint32_t hash) {
+	const size_t group_mask=map->num_groups-1;
+	size_t g=(hash>>7)&group_mask;
+
+	for (size_t step=1; ; step++) {
+		const uint32_t free_slots=group_match_empty_or_deleted(map->ctrl+g*GROUP_SIZE);
+		if (free_slots) return g*GROUP_SIZE+__builtin_ctz(free_slots);
+		g=(g+step)&group_mask;
+	}
+}
+
+// rebuilds the table with num_groups groups, which also removes the DELETED slots
+static bool resize(twr_hashmap_t* map, size_t num_groups) {
+	const size_t capacity=num_groups*GROUP_SIZE;
+	unsigned char* ctrl=map_alloc(map, capacity);
+	struct twr_hashmap_slot* slots=map_alloc(map, capacity*sizeof(struct twr_hashmap_slot));
+	if (ctrl==NULL || slots==NULL) {
+		map_free(map, ctrl);
+		map_free(map, slots);
+		return false;
+	}
+	memset(ctrl, CTRL_EMPTY, capacity);
+
+	unsigned char* old_ctrl=map->ctrl;
+	struct twr_hashmap_slot* old_slots=map->slots;
+	const size_t old_capacity=map->num_groups*GROUP_SIZE;
+
+	map->ctrl=ctrl;
+	map->slots=slots;
+	map->num_groups=num_groups;
+	map->growth_left=max_load(num_groups)-map->count;
+
+	for (size_t i=0; i<old_capacity; i++) {
+		if (old_ctrl[i]&0x80) continue;
+		const uint32_t hash=map_hash(map, old_slots[i].key);
+		const size_t k=find_free_slot(map, hash);
+		ctrl[k]=hash&0x7F;
+		slots[k]=old_slots[i];
+	}
+
+	map_free(map, old_ctrl);
+	map_free(map, old_slots);
+	return true;
+}
+
+/************************************************/
+
+// if arena is not NULL, the table (and the copies of string keys) are allocated from the arena, and are
+// released when the arena is reset or destroyed
+twr_hashmap_t* twr_hashmap_create(twr_hashmap_hash_t hash, twr_hashmap_equal_t equal, twr_arena_t* arena) {
+	assert(hash && equal);
+
+	twr_hashmap_t* map=arena ? twr_arena_alloc(arena, sizeof(twr_hashmap_t)) : malloc(sizeof(twr_hashmap_t));
+	if (map==NULL) return NULL;
+
+	memset(map, 0, sizeof(twr_hashmap_t));
+	map->hash=hash;
+	map->equal=equal;
+	map->arena=arena;
+
+	return map;
+}
+
+// keys are null terminated strings, which are copied by twr_hashmap_put
+twr_hashmap_t* twr_hashmap_create_str(twr_arena_t* arena) {
+	twr_hashmap_t* map=twr_hashmap_create(hash_str, equal_str, arena);
+	if (map) map->keys=KEYS_STR;
+	return map;
+}
+
+// keys are integers, stored in place of the key pointer
+twr_hashmap_t* twr_hashmap_create_int(twr_arena_t* arena) {
+	twr_hashmap_t* map=twr_hashmap_create(hash_int, equal_int, arena);
+	if (map) map->keys=KEYS_INT;
+	return map;
+}
+
+static void free_keys(twr_hashmap_t* map) {
+	if (map->keys!=KEYS_STR || map->arena) return;
+
+	const size_t capacity=map->num_groups*GROUP_SIZE;
+	for (size_t i=0; i<capacity; i++)
+		if ((map->ctrl[i]&0x80)==0)
+			free((void*)map->slots[i].key);
+}
+
+void twr_hashmap_destroy(twr_hashmap_t* map) {
+	if (map==NULL || map->arena) return;
+
+	free_keys(map);
+	free(map->ctrl);
+	free(map->slots);
+	free(map);
+}
+
+void twr_hashmap_clear(twr_hashmap_t* map) {
+	assert(map);
+
+	free_keys(map);
+	if (map->num_groups) {
+		memset(map->ctrl, CTRL_EMPTY, map->num_groups*GROUP_SIZE);
+		map->growth_left=max_load(map->num_groups);
+	}
+	map->count=0;
+}
+
+size_t twr_hashmap_count(twr_hashmap_t* map) {
+	assert(map);
+	return map->count;
+}
+
+// grows the table so that count entries can be added without a resize
+bool twr_hashmap_reserve(twr_hashmap_t* map, size_t count) {
+	assert(map);
+
+	size_t num_groups=map->num_groups ? map->num_groups : 1;
+	while (max_load(num_groups)<map->count+count)
+		num_groups*=2;
+
+	if (num_groups==map->num_groups) return true;
+	return resize(map, num_groups);
+}
+
+// adds key, or replaces the value of an existing key.  Returns false if out of memory.
+bool twr_hashmap_put(twr_hashmap_t* map, const void* key, void* value) {
+	assert(map);
+
+	const uint32_t hash=map_hash(map, key);
+	const intptr_t found=find_slot(map, key, hash);
+	if (found>=0) {
+		map->slots[found].value=value;
+		return true;
+	}
+
+	if (map->growth_left==0) {
+		// if more than half of the used slots are DELETED, rebuild at the same size instead of growing
+		if (map->num_groups && map->count<=max_load(map->num_groups)/2) {
+			if (!resize(map, map->num_groups)) return false;
+		}
+		else {
+			if (!resize(map, map->num_groups ? map->num_groups*2 : 1)) return false;
+		}
+	}
+
+	if (map->keys==KEYS_STR) {
+		const size_t len=strlen(key)+1;
+		char* copy=map_alloc(map, len);
+		if (copy==NULL) return false;
+		memcpy(copy, key, len);
+		key=copy;
+	}
+
+	const size_t i=find_free_slot(map, hash);
+	if (map->ctrl[i]==CTRL_EMPTY) map->growth_left--;
+	map->ctrl[i]=hash&0x7F;
+	map->slots[i].key=key;
+	map->slots[i].value=value;
+	map->count++;
+
+	return true;
+}
+
+// returns true if key is found, and sets *value (if value is not NULL)
+bool twr_hashmap_get(twr_hashmap_t* map, const void* key, void** value) {
+	assert(map);
+
+	const intptr_t i=find_slot(map, key, map_hash(map, key));
+	if (i<0) return false;
+	if (value) *value=map->slots[i].value;
+	return true;
+}
+
+bool twr_hashmap_remove(twr_hashmap_t* map, const void* key) {
+	assert(map);
+
+	const intptr_t i=find_slot(map, key, map_hash(map, key));
+	if (i<0) return false;
+
+	if (map->keys==KEYS_STR) map_free(map, (void*)map->slots[i].key);
+
+	// lookups stop at a group with an EMPTY slot, so if the group already has one, no lookup needs this slot to stay
+	// in use, and it can be EMPTY.  Otherwise a DELETED slot keeps lookups probing past this group.
+	if (group_match_empty(map->ctrl+(i&~(intptr_t)(GROUP_SIZE-1)))) {
+		map->ctrl[i]=CTRL_EMPTY;
+		map->growth_left++;
+	}
+	else {
+		map->ctrl[i]=CTRL_DELETED;
+	}
+	map->count--;
+
+	return true;
+}
+
+// iterates over the entries, in no particular order.  Set *pos to 0 before the first call.
+// Returns false when there are no more entries.  The map must not be changed during the iteration.
+bool twr_hashmap_next(twr_hashmap_t* map, size_t* pos, const void** key, void** value) {
+	assert(map && pos);
+
+	const size_t capacity=map->num_groups*GROUP_SIZE;
+	for (size_t i=*pos; i<capacity; i++) {
+		if ((map->ctrl[i]&0x80)==0) {
+			if (key) *key=map->slots[i].key;
+			if (value) *value=map->slots[i].value;
+			*pos=i+1;
+			return true;
+		}
+	}
+
+	*pos=capacity;
+	return false;
+}
+
+/************************************************/
+
+bool twr_hashmap_put_str(twr_hashmap_t* map, const char* key, void* value) {
+	return twr_hashmap_put(map, key, value);
+}
+
+// returns NULL if key is not found
+void* twr_hashmap_get_str(twr_hashmap_t* map, const char* key) {
+	void* value;
+	return twr_hashmap_get(map, key, &value) ? value : NULL;
+}
+
+bool twr_hashmap_remove_str(twr_hashmap_t* map, const char* key) {
+	return twr_hashmap_remove(map, key);
+}
+
+bool twr_hashmap_put_int(twr_hashmap_t* map, intptr_t key, void* value) {
+	return twr_hashmap_put(map, (const void*)key, value);
+}
+
+// returns NULL if key is not found
+void* twr_hashmap_get_int(twr_hashmap_t* map, intptr_t key) {
+	void* value;
+	return twr_hashmap_get(map, (const void*)key, &value) ? value : NULL;
+}
+
+bool twr_hashmap_remove_int(twr_hashmap_t* map, intptr_t key) {
+	return twr_hashmap_remove(map, (const void*)key);
+}
+
+/************************************************/
+
+// all keys hash to the same group, to test probing past full groups
+static uint32_t hash_collide(const void* key) {
+	return (uint32_t)(intptr_t)key&0x7F;
+}
+
+int hashmap_unit_test(void) {
+	const size_t sz=avail();
+	// the number of keys is reduced to fit when the heap is small, as it is in the gcc unit test build.  N must be even.
+	const size_t fit=sz/(8*sizeof(struct twr_hashmap_slot));
+	const intptr_t N=(intptr_t)(fit<5000 ? fit : 5000)&~1;
+	const int NSTR=(int)N/5;
+
+	// integer keys: put, replace, get, remove, and get again, through several resizes
+	twr_hashmap_t* map=twr_hashmap_create_int(NULL);
+	if (map==NULL) return 0;
+	for (intptr_t i=0; i<N; i++)
+		if (!twr_hashmap_put_int(map, i*7, (void*)(i+1))) return 0;
+	if (twr_hashmap_count(map)!=N) return 0;
+	for (intptr_t i=0; i<N; i+=3)
+		if (!twr_hashmap_put_int(map, i*7, (void*)(i+2))) return 0;
+	if (twr_hashmap_count(map)!=N) return 0;
+	for (intptr_t i=0; i<N; i++) {
+		if (twr_hashmap_get_int(map, i*7)!=(void*)(i%3==0 ? i+2 : i+1)) return 0;
+		if (twr_hashmap_get_int(map, i*7+1)!=NULL) return 0;
+	}
+	for (intptr_t i=0; i<N; i+=2)
+		if (!twr_hashmap_remove_int(map, i*7)) return 0;
+	if (twr_hashmap_remove_int(map, 0)) return 0;
+	if (twr_hashmap_count(map)!=N/2) return 0;
+	for (intptr_t i=0; i<N; i++)
+		if (twr_hashmap_get(map, (const void*)(i*7), NULL)!=(i%2==1)) return 0;
+
+	// iteration visits each entry once
+	size_t pos=0, visited=0;
+	const void* key;
+	void* value;
+	intptr_t sum=0;
+	while (twr_hashmap_next(map, &pos, &key, &value)) {
+		visited++;
+		sum+=(intptr_t)key;
+	}
+	if (visited!=N/2 || sum!=7*(intptr_t)(N/2)*(N/2)) return 0;
+
+	// removing and adding keys, without growing the count, reuses DELETED slots instead of growing the table
+	for (int round=0; round<20; round++) {
+		for (intptr_t i=1; i<N; i+=2)
+			if (!twr_hashmap_remove_int(map, i*7+round)) return 0;
+		for (intptr_t i=1; i<N; i+=2)
+			if (!twr_hashmap_put_int(map, i*7+round+1, (void*)i)) return 0;
+	}
+	if (twr_hashmap_count(map)!=N/2) return 0;
+	for (intptr_t i=1; i<N; i+=2)
+		if (twr_hashmap_get_int(map, i*7+20)!=(void*)i) return 0;
+
+	twr_hashmap_clear(map);
+	if (twr_hashmap_count(map)!=0 || twr_hashmap_get_int(map, 7)!=NULL) return 0;
+	twr_hashmap_destroy(map);
+
+	// string keys are copied
+	map=twr_hashmap_create_str(NULL);
+	char buf[32];
+	for (int i=0; i<NSTR; i++) {
+		snprintf(buf, sizeof(buf), "key %d", i);
+		if (!twr_hashmap_put_str(map, buf, (void*)(intptr_t)i)) return 0;
+	}
+	for (int i=0; i<NSTR; i++) {
+		snprintf(buf, sizeof(buf), "key %d", i);
+		if (twr_hashmap_get_str(map, buf)!=(void*)(intptr_t)i) return 0;
+		if ((i&1) && !twr_hashmap_remove_str(map, buf)) return 0;
+	}
+	if (twr_hashmap_get_str(map, "key 1")!=NULL || twr_hashmap_get_str(map, "key 2")!=(void*)2) return 0;
+	if (twr_hashmap_get_str(map, "")!=NULL) return 0;
+	twr_hashmap_destroy(map);
+
+	// keys that all collide
+	map=twr_hashmap_create(hash_collide, equal_int, NULL);
+	for (intptr_t i=0; i<200; i++)
+		if (!twr_hashmap_put(map, (const void*)(i*128), (void*)i)) return 0;
+	for (intptr_t i=0; i<200; i++)
+		if (twr_hashmap_get_int(map, i*128)!=(void*)i || twr_hashmap_get_int(map, i*128+1)!=NULL) return 0;
+	twr_hashmap_destroy(map);
+
+	if (avail()!=sz) return 0;
+
+	// arena backed, all the memory is released with the arena
+	twr_arena_t* arena=twr_arena_create(0);
+	map=twr_hashmap_create_str(arena);
+	if (!twr_hashmap_reserve(map, 100)) return 0;
+	for (int i=0; i<100; i++) {
+		snprintf(buf, sizeof(buf), "%d", i);
+		if (!twr_hashmap_put_str(map, buf, (void*)(intptr_t)i)) return 0;
+	}
+	if (twr_hashmap_get_str(map, "42")!=(void*)42 || twr_hashmap_count(map)!=100) return 0;
+	twr_hashmap_destroy(map);
+	twr_arena_destroy(arena);
+
+	if (avail()!=sz) return 0;
+
+	return 1;
+}
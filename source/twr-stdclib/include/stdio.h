@@ -33,12 +33,21 @@ int putchar(int c);
 
 typedef twr_ioconsole_t FILE; 
 #define EOF (-1)  
+
+/* buffering modes for setvbuf */
+#define _IOFBF 1
+#define _IOLBF 2
+#define _IONBF 3
+#define BUFSIZ TWR_IO_BUFSIZ
+
 int vfprintf(FILE *stream, const char *format, va_list vlist);
 int fprintf(FILE *stream, const char* format, ...);
 size_t fwrite(const void* buffer, size_t size, size_t count, FILE* stream);
 int ferror(FILE *stream);
 int feof(FILE *stream);
 int fflush(FILE *stream);
+int setvbuf(FILE* stream, char* buffer, int mode, size_t size);
+void setbuf(FILE* stream, char* buffer);
 int is_terminal(FILE *stream);
 #define _LIBCPP_TESTING_PRINT_IS_TERMINAL(x) is_terminal(x)
 int fputc(int ch, FILE* stream);
@@ -22,6 +22,7 @@ size_t avail(void);
 void *realloc( void *ptr, size_t new_size );
 void* calloc( size_t num, size_t size );
 void *aligned_alloc( size_t alignment, size_t size );
+int posix_memalign(void **memptr, size_t alignment, size_t size);
 
 /************************/
 
@@ -39,7 +40,7 @@ int abs(int n);
 /************************/
 
 //The fcvt_s() function in C does not use locale information; it always uses . (a dot) as the decimal separator.
-__attribute__((import_name("twrFcvtS"))) int _fcvt_s(
+int _fcvt_s(
    char* buffer,
    unsigned long sizeInBytes,  //size_t 
    double value,
@@ -68,6 +69,12 @@ int _itoa_s(int64_t value, char * buffer, size_t size, int radix);
 
 /************************/
 
+void qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *));
+void qsort_r(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *, void *), void *arg);
+void *bsearch(const void *key, const void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *));
+
+/************************/
+
 typedef struct {
 	int quot;	
 	int rem;		
@@ -26,17 +26,18 @@ void *memchr(const void *ptr, int ch, size_t count);
 size_t strxfrm(char *dest, const char *source, size_t count);
 size_t strxfrm_l(char *dest, const char *source, size_t count, locale_t __attribute__((__unused__)) locale);
 char *strstr(const char *haystack, const char *needle);
+void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_t needlelen);
 char * strerror(int errnum );
 char * _strerror(const char *strErrMsg);
-void *memmove(void *dest, const void *src, size_t n);
 int memcmp( const void* lhs, const void* rhs, size_t count );
-void bzero (void *to, size_t count);
 
 #define TWR_STRXFRM_MARKER 0xFFFFFFFF
 
 // implemented in memcpy.wat
 void *memcpy(void *dest, const void * src, size_t n);
+void *memmove(void *dest, const void *src, size_t n);
 void *memset(void *mem, int c, size_t n);
+void bzero (void *to, size_t count);
 
 #ifdef __cplusplus
 }
@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h> // strcmp
+#include <errno.h>
 #include "twr-crt.h"
 
 
@@ -11,11 +12,18 @@
 #define VALID_MALLOC_MARKER (0x1234ABCD)
 
 /* heap map bit is set to 1 for allocated entries of size ALLOC_SIZE and 0 for free entries */
-#define MAP_ENTRY_BITS 8
-static size_t heap_map_size_in_bytes;
-static unsigned char *heap_map;
-//#define heap_map_size_in_bytes 1250
-//static unsigned char heap_map[heap_map_size_in_bytes];
+/* the map is followed by two summary levels, so that searches can skip over entire words of allocated entries */
+/*    map_nonfull bit is set to 1 if the corresponding heap_map word has at least one free entry */
+/*    map_nonfull2 bit is set to 1 if the corresponding map_nonfull word is not zero */
+#define MAP_ENTRY_BITS 64
+#define MAP_WORD_SHIFT 6
+static size_t heap_map_size_in_bytes;  // includes both summary levels
+static uint64_t *heap_map;
+static uint64_t *map_nonfull;
+static uint64_t *map_nonfull2;
+static size_t heap_map_words;
+static size_t map_nonfull_words;
+static size_t map_nonfull2_words;
 
 // number of bytes in each allocation chunk, as well as the alignment of the allocation
 // to modify allocation/align size, it is not sufficient to just change ALLOC_SIZE since type uint64_t is used throughout
@@ -23,8 +31,85 @@ static unsigned char *heap_map;
 #define ALLOC_SIZE 8   
 #define ALLOC_SIZE_MASK (ALLOC_SIZE-1)
 
+// each allocation is preceded by two alloc units: VALID_MALLOC_MARKER and the size
+#define HEADER_UNITS 2
+
 static size_t heap_size_in_alloc_units;
 static uint64_t *heap;
+static size_t heap_free_units;  // number of heap_map bits set to 0, returned by avail()
+
+static size_t realloc_in_place_count;  // reallocs that resized the block where it is
+static size_t realloc_moved_count;     // reallocs that had to malloc, copy, and free
+static size_t heap_grow_count;         // number of times the heap was extended with memory.grow
+
+// heap profiling is off until twr_heap_profile(true) is called, and then costs a few counter updates per malloc and free
+static bool heap_profiling;
+static struct twr_heap_stats heap_profile;
+
+#define NO_UNIT (0xFFFFFFFF)
+
+/************************************************/
+
+// Define TWR_MALLOC_THREADS to build an allocator that can be used by several workers sharing the same Wasm memory
+// (compile with -matomics -mbulk-memory, as twr-mt.a is).  The heap and the twr_cache_malloc bins are each
+// protected by a lock, and each thread keeps a small cache of freed small blocks (see thread_cache_take) so that
+// most malloc/free pairs don't touch a lock at all.  Without TWR_MALLOC_THREADS the lock macros are empty.
+
+#ifdef TWR_MALLOC_THREADS
+
+#if defined(__wasm__) && !defined(__wasm_atomics__)
+#error "TWR_MALLOC_THREADS requires -matomics"
+#endif
+
+// a lock is 0 when free, 1 when held, and 2 when held and another thread may be waiting.
+// a thread that can't get the lock spins briefly, then waits (memory.atomic.wait32) until the holder notifies it.
+#define LOCK_SPIN_COUNT 100
+
+static int heap_lock;   // heap_map, bins, and the heap counters
+static int cache_lock;  // twr_cache_malloc bin_table
+
+static void lock_acquire(int* lock) {
+	int c=0;
+	if (__atomic_compare_exchange_n(lock, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		return;
+
+	for (int i=0; i<LOCK_SPIN_COUNT; i++) {
+		c=0;
+		if (__atomic_load_n(lock, __ATOMIC_RELAXED)==0 && __atomic_compare_exchange_n(lock, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return;
+	}
+
+	while (__atomic_exchange_n(lock, 2, __ATOMIC_ACQUIRE)!=0) {
+#ifdef __wasm__
+		__builtin_wasm_memory_atomic_wait32(lock, 2, -1);
+#endif
+	}
+}
+
+static void lock_release(int* lock) {
+	if (__atomic_exchange_n(lock, 0, __ATOMIC_RELEASE)==2) {
+#ifdef __wasm__
+		__builtin_wasm_memory_atomic_notify(lock, 1);
+#endif
+	}
+}
+
+static bool lock_try(int* lock) {
+	int c=0;
+	return __atomic_compare_exchange_n(lock, &c, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+#define LOCK(l) lock_acquire(&l)
+#define UNLOCK(l) lock_release(&l)
+#define TRY_LOCK(l) lock_try(&l)
+
+#else
+
+#define LOCK(l)
+#define UNLOCK(l)
+#define TRY_LOCK(l) true
+
+#endif
 
 size_t heap_size_in_bytes;
 size_t mem_size_in_bytes;
@@ -32,6 +117,36 @@ size_t mem_size_in_bytes;
 //#define heap_size_in_alloc_units 10000
 //static uint64_t heap[heap_size_in_alloc_units];
 
+/************************************************/
+
+// By default free memory is kept in segregated size-class free lists ("bins"), so malloc and free
+// don't have to scan heap_map.  Define TWR_MALLOC_FIRST_FIT to use the original (smaller but slower) 
+// heap engine, which searches heap_map from unit 0 for the first free run that fits.
+
+#ifndef TWR_MALLOC_FIRST_FIT
+
+/* a run of free alloc units is a "free range", and has format: */
+/*    <FREE_RANGE_MARKER,size in units><next,prev bin links><unused...><FREE_RANGE_MARKER,size in units> */
+/* free ranges of 1 or 2 units are too small to hold an allocation, so they are not linked into a bin. */
+/* they still have the size tags, so that they can be coalesced when a neighbor is freed */
+#define FREE_RANGE_MARKER (0xF3EEF3EEULL)
+#define MIN_BIN_RANGE_UNITS (HEADER_UNITS+1)
+
+// free ranges smaller than SMALL_BIN_UNITS each have a bin of the exact size, so small allocations are an O(1) pop.
+// larger ranges are binned by power of two (log2 of size), with each power of two divided into 2^BIN_SUB_BITS sub bins
+#define SMALL_BIN_UNITS 64
+#define SMALL_BIN_LOG2 6
+#define BIN_SUB_BITS 3
+#define NUM_BINS (SMALL_BIN_UNITS+(32-SMALL_BIN_LOG2)*(1<<BIN_SUB_BITS))
+
+// max number of ranges to check in a bin where some ranges may be too small before using a larger bin
+#define BIN_SEARCH_LIMIT 16
+
+static uint32_t bin_head[NUM_BINS];
+static uint32_t bin_nonempty[(NUM_BINS+31)/32];  // bit set if bin_head[] is valid
+
+#endif
+
 /************************************************/
 /************************************************/
 
@@ -41,6 +156,38 @@ size_t mem_size_in_bytes;
 //The stack starts at __data_end, the heap starts at __heap_base. 
 //Because the stack is placed first, it is limited to a maximum size set at compile time, which is __heap_base - __data_end.
 
+static void heap_release(size_t start, size_t len);
+static void map_init_summary(void);
+static size_t largest_free_run(void);
+static void large_debug_stats(twr_ioconsole_t* outcon);
+
+// split mem_size_in_bytes (starting at heap) into the heap, heap_map, and the heap_map summaries
+static void heap_layout(void) {
+	// each heap_map word maps MAP_ENTRY_BITS units, and needs 1/64 and 1/4096 of a word for the summary levels.
+	// start with an estimate, and reduce it until the heap, map, and summaries fit
+	heap_map_words=mem_size_in_bytes/(ALLOC_SIZE*MAP_ENTRY_BITS+sizeof(uint64_t));
+	while (1) {
+		map_nonfull_words=(heap_map_words+63)>>6;
+		map_nonfull2_words=(map_nonfull_words+63)>>6;
+		heap_map_size_in_bytes=(heap_map_words+map_nonfull_words+map_nonfull2_words)*sizeof(uint64_t);
+		if (heap_map_words*MAP_ENTRY_BITS*ALLOC_SIZE+heap_map_size_in_bytes <= mem_size_in_bytes) break;
+		heap_map_words--;
+	}
+
+	heap_size_in_alloc_units=heap_map_words*MAP_ENTRY_BITS;
+	heap_size_in_bytes=heap_size_in_alloc_units*ALLOC_SIZE;
+
+	heap_map=heap+heap_size_in_alloc_units;
+	map_nonfull=heap_map+heap_map_words;
+	map_nonfull2=map_nonfull+map_nonfull_words;
+
+	assert(heap_size_in_alloc_units>0);
+	assert(heap_map_size_in_bytes>0);
+
+	assert(heap_size_in_alloc_units*ALLOC_SIZE+heap_map_size_in_bytes <= mem_size_in_bytes);
+	assert((unsigned char*)heap_map+heap_map_size_in_bytes<=(unsigned char*)heap+mem_size_in_bytes);
+}
+
 // add init call to unit tests
 void twr_init_malloc(void* memp, size_t mem_sizeb) {
 	//twr_conlog("twr_init_malloc %x %d %d",mem, mem_sizeb, sizeof(mem));
@@ -50,77 +197,489 @@ void twr_init_malloc(void* memp, size_t mem_sizeb) {
 	
 	assert(heap_map_size_in_bytes==0); // check that init only called once
 
+	heap=(uint64_t*)mem;
 	mem_size_in_bytes=mem_sizeb;
+	heap_layout();
 
-	heap_size_in_bytes=mem_size_in_bytes/(ALLOC_SIZE*8+1); // eg. we need 1 bit per ALLOC_SIZE for map, or 1 byte per ALLOC_SIZE*8
-	heap_size_in_bytes=heap_size_in_bytes*ALLOC_SIZE*8;
-	heap_size_in_bytes=heap_size_in_bytes & (~ALLOC_SIZE_MASK);  // round down to ALLOC_SIZE units
-	assert(heap_size_in_bytes>0);
+	// the map memory may not be zero (eg. gcc unit tests), and every unit starts out free
+	memset(heap_map, 0, heap_map_words*sizeof(uint64_t));
+	map_init_summary();
+	heap_free_units=0;
+	heap_release(0, heap_size_in_alloc_units);
+}
 
-	heap=(uint64_t*)mem;
-	heap_size_in_alloc_units=heap_size_in_bytes/ALLOC_SIZE;
+// add 'add_bytes' of memory, which must directly follow the current end of the heap map, to the heap.
+// the heap map is moved to the new end of memory, and the new units (including where the map was) are freed.
+static void heap_extend(size_t add_bytes) {
+	const size_t old_units=heap_size_in_alloc_units;
+	const size_t old_map_words=heap_map_words;
+	uint64_t* const old_map=heap_map;
 
-	heap_map=(unsigned char*)mem+heap_size_in_bytes;
-	heap_map_size_in_bytes=heap_size_in_bytes/(ALLOC_SIZE*8);
+	mem_size_in_bytes+=add_bytes;
+	heap_layout();
+	assert(heap_size_in_alloc_units>=old_units);
 
-	assert(heap_size_in_alloc_units>0);
-	assert(heap_map_size_in_bytes>0);
+	if (heap_size_in_alloc_units==old_units)
+		return;
 
-	assert(heap_size_in_alloc_units*ALLOC_SIZE+heap_map_size_in_bytes <= mem_size_in_bytes);
-	assert(heap_map+heap_map_size_in_bytes<=(unsigned char*)mem+mem_size_in_bytes);
+	// new units start out allocated, and are then freed, so that they coalesce with a free range at the old end of the heap
+	memmove(heap_map, old_map, old_map_words*sizeof(uint64_t));
+	memset(heap_map+old_map_words, 0xFF, (heap_map_words-old_map_words)*sizeof(uint64_t));
+	map_init_summary();
+	heap_release(old_units, heap_size_in_alloc_units-old_units);
+
+	heap_grow_count++;
+}
+
+#define WASM_PAGE_SIZE (64*1024)
+
+// called when a malloc of 'units' alloc units fails.  Grows the Wasm memory with memory.grow, and adds it to the heap.
+// Returns false if the memory can't grow (for example if wasm-ld --max-memory is the same as --initial-memory)
+static bool heap_grow(size_t units) {
+#ifdef __wasm__
+	// the heap can only grow if it ends at the end of Wasm memory
+	const uint64_t mem_end=(uint64_t)__builtin_wasm_memory_size(0)*WASM_PAGE_SIZE;
+	if ((uint64_t)(uintptr_t)heap+mem_size_in_bytes != mem_end)
+		return false;
+
+	// the allocation plus the heap map bits it needs, and grow by at least 1/8 of the heap so that a series of 
+	// small allocations doesn't call memory.grow each time
+	uint64_t bytes=(uint64_t)units*ALLOC_SIZE+(uint64_t)units/8+WASM_PAGE_SIZE;
+	if (bytes < mem_size_in_bytes/8) bytes=mem_size_in_bytes/8;
+	size_t pages=(bytes+WASM_PAGE_SIZE-1)/WASM_PAGE_SIZE;
+	const size_t min_pages=((uint64_t)units*ALLOC_SIZE+(uint64_t)units/8+WASM_PAGE_SIZE-1)/WASM_PAGE_SIZE+1;
+
+	if (__builtin_wasm_memory_grow(0, pages)==(size_t)-1) {
+		pages=min_pages;
+		if (__builtin_wasm_memory_grow(0, pages)==(size_t)-1)
+			return false;
+	}
+
+	heap_extend(pages*WASM_PAGE_SIZE);
+	return true;
+#else
+	(void)units;
+	return false;
+#endif
 }
 
 void twr_malloc_debug_stats(twr_ioconsole_t* outcon) {
 	io_printf(outcon, "malloc stats:\n");
 	io_printf(outcon, "   heap start addr: 0x%x\n", heap);
 	io_printf(outcon, "   heap size bytes: %d\n", heap_size_in_bytes);
-	io_printf(outcon, "   heap allocation map offset from heap start: 0x%x %d\n", heap_map-(unsigned char*)heap, heap_map-(unsigned char*)heap);
+	io_printf(outcon, "   heap allocation map offset from heap start: 0x%x %d\n", (unsigned char*)heap_map-(unsigned char*)heap, (unsigned char*)heap_map-(unsigned char*)heap);
 	io_printf(outcon, "   heap allocation map size bytes: %d\n", heap_map_size_in_bytes);
 	io_printf(outcon, "   heap size in alloc units: %d\n", heap_size_in_alloc_units);
 	io_printf(outcon, "   unused padding: %d\n", mem_size_in_bytes-heap_size_in_bytes-heap_map_size_in_bytes);
 	io_printf(outcon, "   avail() returns: %d\n", avail());
+	io_printf(outcon, "   realloc in place: %d\n", realloc_in_place_count);
+	io_printf(outcon, "   realloc moved: %d\n", realloc_moved_count);
+	io_printf(outcon, "   heap grown: %d times\n", heap_grow_count);
+	io_printf(outcon, "   largest free run: %d\n", largest_free_run());
+	large_debug_stats(outcon);
+	if (heap_profiling) {
+		io_printf(outcon, "   live bytes: %d (peak %d)\n", heap_profile.live_bytes, heap_profile.peak_live_bytes);
+		io_printf(outcon, "   live allocations: %d, total allocations: %d, total frees: %d\n", heap_profile.live_allocations, heap_profile.total_allocations, heap_profile.total_frees);
+		for (int c=0; c<TWR_HEAP_STATS_SIZE_CLASSES; c++)
+			if (heap_profile.live_by_size_class[c])
+				io_printf(outcon, "   live allocations %s%d bytes: %d\n", c==TWR_HEAP_STATS_SIZE_CLASSES-1?"> ":"<= ", (ALLOC_SIZE<<c)>>(c==TWR_HEAP_STATS_SIZE_CLASSES-1), heap_profile.live_by_size_class[c]);
+	}
 }
 
 /************************************************//************************************************/
 
-static bool is_alloc_unit_free(unsigned long i) {
-	unsigned long idx=i/MAP_ENTRY_BITS;
-	unsigned char bit=(i-idx*MAP_ENTRY_BITS);
-	return (heap_map[idx]&(1<<bit))==0;
+static inline bool is_alloc_unit_free(size_t i) {
+	return ((heap_map[i>>MAP_WORD_SHIFT]>>(i&63))&1)==0;
 }
 
-static void set_free_state(unsigned long i, bool do_alloc) {
-	unsigned long idx=i/MAP_ENTRY_BITS;
-	unsigned char bit=i-idx*MAP_ENTRY_BITS;
-	assert (bit<8);
-	if (do_alloc)
-		heap_map[idx]|=((unsigned char)1 << bit);
-	else
-		heap_map[idx]&=(~(1<<bit));
+// mask of bits first..last (inclusive) in a 64 bit word
+static inline uint64_t map_mask(unsigned first, unsigned last) {
+	return (~0ULL<<first) & (~0ULL>>(63-last));
 }
 
-static int find_next_free_chunk(unsigned long *start, unsigned long *len) {
-	unsigned long i=*start;
-	while(i < heap_size_in_alloc_units) {
-		if (is_alloc_unit_free(i)) { //free word?
-			*start=i++;
-			while (i < heap_size_in_alloc_units && is_alloc_unit_free(i))
-				i++;
-			*len = i-(*start);
-			return 1;
+static inline void map_summary_set(size_t w) {
+	map_nonfull[w>>6]|=(1ULL<<(w&63));
+	map_nonfull2[w>>12]|=(1ULL<<((w>>6)&63));
+}
+
+static inline void map_summary_clear(size_t w) {
+	map_nonfull[w>>6]&=~(1ULL<<(w&63));
+	if (map_nonfull[w>>6]==0)
+		map_nonfull2[w>>12]&=~(1ULL<<((w>>6)&63));
+}
+
+// rebuild both summary levels from heap_map
+static void map_init_summary(void) {
+	memset(map_nonfull, 0, (map_nonfull_words+map_nonfull2_words)*sizeof(uint64_t));
+	for (size_t w=0; w<heap_map_words; w++)
+		if (heap_map[w]!=~0ULL)
+			map_summary_set(w);
+}
+
+// mark 'len' units starting at 'start' as allocated (do_alloc==true) or free, one map word at a time
+static void set_free_state(size_t start, size_t len, bool do_alloc) {
+	if (len==0) return;
+
+	const size_t last=start+len-1;
+	const size_t first_w=start>>MAP_WORD_SHIFT;
+	const size_t last_w=last>>MAP_WORD_SHIFT;
+
+	for (size_t w=first_w; w<=last_w; w++) {
+		const uint64_t mask=map_mask(w==first_w?(start&63):0, w==last_w?(last&63):63);
+		if (do_alloc) {
+			heap_map[w]|=mask;
+			if (heap_map[w]==~0ULL)
+				map_summary_clear(w);
 		}
 		else {
-			i++;
+			heap_map[w]&=~mask;
+			map_summary_set(w);
+		}
+	}
+}
+
+// true if every unit in start..start+len-1 is allocated (do_alloc==true) or free
+static bool is_range_state(size_t start, size_t len, bool do_alloc) {
+	if (len==0) return true;
+
+	const size_t last=start+len-1;
+	const size_t first_w=start>>MAP_WORD_SHIFT;
+	const size_t last_w=last>>MAP_WORD_SHIFT;
+
+	for (size_t w=first_w; w<=last_w; w++) {
+		const uint64_t mask=map_mask(w==first_w?(start&63):0, w==last_w?(last&63):63);
+		if ((heap_map[w]&mask) != (do_alloc?mask:0))
+			return false;
+	}
+	return true;
+}
+
+// returns the first free unit >= i, or heap_size_in_alloc_units if there are none.
+// map words with no free units are skipped using the summary levels.
+static size_t map_find_free(size_t i) {
+	if (i>=heap_size_in_alloc_units) return heap_size_in_alloc_units;
+
+	size_t w=i>>MAP_WORD_SHIFT;
+	uint64_t bits=~heap_map[w]&(~0ULL<<(i&63));
+	if (bits) return (w<<MAP_WORD_SHIFT)+__builtin_ctzll(bits);
+
+	// next map word with a free unit, within the current map_nonfull word
+	w++;
+	size_t s=w>>6;
+	if (s>=map_nonfull_words) return heap_size_in_alloc_units;
+	bits=map_nonfull[s]&(~0ULL<<(w&63));
+
+	if (bits==0) {
+		// next non zero map_nonfull word, using map_nonfull2
+		s++;
+		size_t s2=s>>6;
+		if (s2>=map_nonfull2_words) return heap_size_in_alloc_units;
+		uint64_t bits2=map_nonfull2[s2]&(~0ULL<<(s&63));
+		while (bits2==0) {
+			if (++s2>=map_nonfull2_words) return heap_size_in_alloc_units;
+			bits2=map_nonfull2[s2];
+		}
+		s=(s2<<6)+__builtin_ctzll(bits2);
+		bits=map_nonfull[s];
+		assert(bits);
+	}
+
+	w=(s<<6)+__builtin_ctzll(bits);
+	assert(heap_map[w]!=~0ULL);
+	return (w<<MAP_WORD_SHIFT)+__builtin_ctzll(~heap_map[w]);
+}
+
+// returns the first allocated unit >= i, but stops looking at 'limit' (which is returned if all units before it are free)
+static size_t map_find_allocated(size_t i, size_t limit) {
+	if (limit>heap_size_in_alloc_units) limit=heap_size_in_alloc_units;
+	if (i>=limit) return limit;
+
+	size_t w=i>>MAP_WORD_SHIFT;
+	uint64_t bits=heap_map[w]&(~0ULL<<(i&63));
+	const size_t limit_w=(limit-1)>>MAP_WORD_SHIFT;
+
+	while (bits==0) {
+		if (++w>limit_w) return limit;
+		bits=heap_map[w];
+	}
+
+	const size_t found=(w<<MAP_WORD_SHIFT)+__builtin_ctzll(bits);
+	return found<limit?found:limit;
+}
+
+/************************************************/
+
+#ifdef TWR_MALLOC_FIRST_FIT
+
+// find the first free run of at least 'len' units, mark them allocated, and return the first unit (or NO_UNIT)
+static size_t heap_take(size_t len) {
+	size_t start=map_find_free(0);
+
+	while (start+len <= heap_size_in_alloc_units) {
+		const size_t end=map_find_allocated(start, start+len);
+		if (end-start >= len) {
+			set_free_state(start, len, 1);
+			heap_free_units-=len;
+			return start;
 		}
+		start=map_find_free(end);
+	}
+
+	return NO_UNIT;
+}
+
+// mark 'len' units starting at 'start' as free
+static void heap_release(size_t start, size_t len) {
+	set_free_state(start, len, 0);
+	heap_free_units+=len;
+}
+
+// if the 'len' units starting at 'start' are all free, mark them allocated and return true
+static bool heap_take_at(size_t start, size_t len) {
+	if (start+len > heap_size_in_alloc_units)
+		return false;
+
+	if (!is_range_state(start, len, 0))
+		return false;
+
+	set_free_state(start, len, 1);
+	heap_free_units-=len;
+
+	return true;
+}
+
+#else
+
+/************************************************/
+
+static inline uint64_t range_tag(size_t len) {
+	return (FREE_RANGE_MARKER<<32)|len;
+}
+
+static inline size_t range_tag_len(uint64_t tag) {
+	assert((tag>>32)==FREE_RANGE_MARKER);
+	return (size_t)(tag&0xFFFFFFFF);
+}
+
+static inline uint32_t range_next(size_t start) {
+	return (uint32_t)heap[start+1];
+}
+
+static inline uint32_t range_prev(size_t start) {
+	return (uint32_t)(heap[start+1]>>32);
+}
+
+static inline void range_set_links(size_t start, uint32_t next, uint32_t prev) {
+	heap[start+1]=((uint64_t)prev<<32)|next;
+}
+
+static int bin_index(size_t len) {
+	if (len < SMALL_BIN_UNITS) return len;
+	const int log2=31-__builtin_clz(len);
+	const int sub=(len>>(log2-BIN_SUB_BITS))&((1<<BIN_SUB_BITS)-1);
+	return SMALL_BIN_UNITS+((log2-SMALL_BIN_LOG2)<<BIN_SUB_BITS)+sub;
+}
+
+static inline bool bin_is_empty(int b) {
+	return (bin_nonempty[b/32]&(1U<<(b%32)))==0;
+}
+
+// returns the first non empty bin >= b, or -1
+static int bin_next_nonempty(int b) {
+	int w=b/32;
+	uint32_t bits=bin_nonempty[w]&(~0U<<(b%32));
+	while (1) {
+		if (bits) return w*32+__builtin_ctz(bits);
+		if (++w==(NUM_BINS+31)/32) return -1;
+		bits=bin_nonempty[w];
+	}
+}
+
+static void bin_insert(size_t start, size_t len) {
+	const int b=bin_index(len);
+
+	if (bin_is_empty(b)) {
+		range_set_links(start, NO_UNIT, NO_UNIT);
+		bin_nonempty[b/32]|=(1U<<(b%32));
+	}
+	else {
+		const uint32_t next=bin_head[b];
+		range_set_links(start, next, NO_UNIT);
+		range_set_links(next, range_next(next), start);
+	}
+	bin_head[b]=start;
+}
+
+static void bin_remove(size_t start, size_t len) {
+	const uint32_t next=range_next(start);
+	const uint32_t prev=range_prev(start);
+
+	if (prev==NO_UNIT) {
+		const int b=bin_index(len);
+		assert(bin_head[b]==start);
+		if (next==NO_UNIT)
+			bin_nonempty[b/32]&=~(1U<<(b%32));
+		else
+			bin_head[b]=next;
+	}
+	else {
+		range_set_links(prev, next, range_prev(prev));
+	}
+
+	if (next!=NO_UNIT)
+		range_set_links(next, range_next(next), prev);
+}
+
+// add a free range to the size tags and bins.  Its heap_map bits must already be 0.
+static void range_add(size_t start, size_t len) {
+	heap[start]=range_tag(len);
+	heap[start+len-1]=range_tag(len);
+	if (len>=MIN_BIN_RANGE_UNITS)
+		bin_insert(start, len);
+}
+
+static void range_remove(size_t start, size_t len) {
+	if (len>=MIN_BIN_RANGE_UNITS)
+		bin_remove(start, len);
+}
+
+// find 'len' free units, mark them allocated, and return the first unit (or NO_UNIT)
+static size_t heap_take(size_t len) {
+	const int b=bin_index(len);
+	size_t start=NO_UNIT;
+	size_t range_len=0;
+
+	// a bin below SMALL_BIN_UNITS holds ranges of exactly one size, a larger bin holds a span of sizes 
+	if (!bin_is_empty(b)) {
+		uint32_t r=bin_head[b];
+		for (int i=0; r!=NO_UNIT && i<BIN_SEARCH_LIMIT; i++) {
+			const size_t rlen=range_tag_len(heap[r]);
+			if (rlen>=len) {
+				start=r;
+				range_len=rlen;
+				break;
+			}
+			r=range_next(r);
+		}
+	}
+
+	// every range in a higher bin is large enough
+	if (start==NO_UNIT) {
+		const int nb=bin_next_nonempty(b+1);
+		if (nb>=0) {
+			start=bin_head[nb];
+			range_len=range_tag_len(heap[start]);
+		}
+	}
+
+	// rare: only ranges in bin b that were past BIN_SEARCH_LIMIT fit
+	if (start==NO_UNIT && !bin_is_empty(b)) {
+		for (uint32_t r=bin_head[b]; r!=NO_UNIT; r=range_next(r)) {
+			const size_t rlen=range_tag_len(heap[r]);
+			if (rlen>=len) {
+				start=r;
+				range_len=rlen;
+				break;
+			}
+		}
+	}
+
+	if (start==NO_UNIT)
+		return NO_UNIT;
+
+	assert(range_len>=len);
+	range_remove(start, range_len);
+	if (range_len>len)
+		range_add(start+len, range_len-len);
+
+	set_free_state(start, len, 1);
+	heap_free_units-=len;
+
+	return start;
+}
+
+// mark 'len' units starting at 'start' as free, and coalesce with neighboring free ranges
+static void heap_release(size_t start, size_t len) {
+	set_free_state(start, len, 0);
+	heap_free_units+=len;
+
+	const size_t end=start+len;
+
+	if (start>0 && is_alloc_unit_free(start-1)) {
+		const size_t left_len=range_tag_len(heap[start-1]);
+		start-=left_len;
+		len+=left_len;
+		range_remove(start, left_len);
+	}
+
+	if (end<heap_size_in_alloc_units && is_alloc_unit_free(end)) {
+		const size_t right_len=range_tag_len(heap[end]);
+		len+=right_len;
+		range_remove(end, right_len);
 	}
-	return 0;  // failed to find free memory
+
+	range_add(start, len);
+}
+
+// if a free range of at least 'len' units starts at 'start', mark those units allocated and return true.
+// the unit before 'start' must be allocated, so a free range can only begin at 'start'.
+static bool heap_take_at(size_t start, size_t len) {
+	if (start>=heap_size_in_alloc_units || !is_alloc_unit_free(start))
+		return false;
+
+	const size_t range_len=range_tag_len(heap[start]);
+	if (range_len<len)
+		return false;
+
+	range_remove(start, range_len);
+	if (range_len>len)
+		range_add(start+len, range_len-len);
+
+	set_free_state(start, len, 1);
+	heap_free_units-=len;
+
+	return true;
+}
+
+#endif
+
+/************************************************/
+
+static int size_class(size_t size_in_alloc_units) {
+	if (size_in_alloc_units<=1) return 0;
+	const int c=32-__builtin_clz((uint32_t)(size_in_alloc_units-1));  // ceil(log2(units))
+	return c<TWR_HEAP_STATS_SIZE_CLASSES?c:TWR_HEAP_STATS_SIZE_CLASSES-1;
+}
+
+static void profile_alloc(size_t size_in_alloc_units) {
+	heap_profile.live_bytes+=size_in_alloc_units*ALLOC_SIZE;
+	if (heap_profile.live_bytes>heap_profile.peak_live_bytes)
+		heap_profile.peak_live_bytes=heap_profile.live_bytes;
+	heap_profile.live_allocations++;
+	heap_profile.total_allocations++;
+	heap_profile.live_by_size_class[size_class(size_in_alloc_units)]++;
+}
+
+static void profile_free(size_t size_in_alloc_units) {
+	heap_profile.live_bytes-=size_in_alloc_units*ALLOC_SIZE;
+	heap_profile.live_allocations--;
+	heap_profile.total_frees++;
+	heap_profile.live_by_size_class[size_class(size_in_alloc_units)]--;
 }
 
+static void profile_resize(size_t old_units, size_t new_units) {
+	profile_free(old_units);
+	profile_alloc(new_units);
+	heap_profile.total_allocations--;
+	heap_profile.total_frees--;
+}
+
+/************************************************/
+
 static void take_some_memory(unsigned long start, size_t size_in_alloc_units) {
 	heap[start]=VALID_MALLOC_MARKER;
 	heap[start+1]=size_in_alloc_units;
-	for (unsigned long i=0; i < (size_in_alloc_units+2); i++)
-		set_free_state(start+i, 1);
+	if (heap_profiling) profile_alloc(size_in_alloc_units);
 }
 
 static size_t malloc_units(void *mem) {
@@ -130,6 +689,385 @@ static size_t malloc_units(void *mem) {
 	return size_in_alloc_units;
 }
 
+/************************************************/
+
+#ifdef TWR_MALLOC_THREADS
+
+// each thread keeps freed blocks of up to THREAD_CACHE_CLASSES units on a list per size, so that malloc and free of
+// small blocks don't take heap_lock.  A cached block keeps its header, with THREAD_CACHED_MARKER in place of
+// VALID_MALLOC_MARKER (so a double free is still caught), and the unit index of the next cached block in its first data unit.
+// the blocks remain allocated in heap_map until they are reused, or twr_malloc_thread_flush() returns them to the heap.
+#define THREAD_CACHE_CLASSES 32
+#define THREAD_CACHE_MAX_ENTRIES 16
+#define THREAD_CACHED_MARKER (0x7CAC4ED7)
+
+struct thread_cache {
+	size_t first[THREAD_CACHE_CLASSES];  // heap unit of the first cached block's header
+	unsigned char count[THREAD_CACHE_CLASSES];
+};
+
+static _Thread_local struct thread_cache thread_cache;
+
+static void* thread_cache_take(size_t size_in_alloc_units) {
+	const size_t c=size_in_alloc_units-1;
+	if (thread_cache.count[c]==0) return NULL;
+
+	const size_t start=thread_cache.first[c];
+	thread_cache.first[c]=heap[start+HEADER_UNITS];
+	thread_cache.count[c]--;
+	heap[start]=VALID_MALLOC_MARKER;
+
+	if (heap_profiling) {
+		LOCK(heap_lock);
+		profile_alloc(size_in_alloc_units);
+		UNLOCK(heap_lock);
+	}
+
+	return &heap[start+HEADER_UNITS];
+}
+
+static bool thread_cache_put(size_t start, size_t size_in_alloc_units) {
+	const size_t c=size_in_alloc_units-1;
+	if (thread_cache.count[c]>=THREAD_CACHE_MAX_ENTRIES) return false;
+
+	heap[start]=THREAD_CACHED_MARKER;
+	heap[start+HEADER_UNITS]=thread_cache.count[c]?thread_cache.first[c]:NO_UNIT;
+	thread_cache.first[c]=start;
+	thread_cache.count[c]++;
+
+	if (heap_profiling) {
+		LOCK(heap_lock);
+		profile_free(size_in_alloc_units);
+		UNLOCK(heap_lock);
+	}
+
+	return true;
+}
+
+// return the calling thread's cached blocks to the heap.  heap_lock must be held.
+static void thread_cache_release(void) {
+	for (size_t c=0; c<THREAD_CACHE_CLASSES; c++) {
+		size_t start=thread_cache.first[c];
+		for (; thread_cache.count[c]>0; thread_cache.count[c]--) {
+			const size_t next=heap[start+HEADER_UNITS];
+			heap[start]=0xDEADBEEFDEADBEEF;
+			heap_release(start, c+1+HEADER_UNITS);
+			start=next;
+		}
+	}
+}
+
+#endif
+
+// a worker that is about to exit should call this, so that its cached blocks aren't lost.
+// does nothing unless built with TWR_MALLOC_THREADS
+void twr_malloc_thread_flush(void) {
+#ifdef TWR_MALLOC_THREADS
+	LOCK(heap_lock);
+	thread_cache_release();
+	UNLOCK(heap_lock);
+#endif
+}
+
+/************************************************/
+
+// heap_take(), but if there isn't a free run of 'len' units, grow the heap and try again
+// heap_lock must be held
+static size_t heap_take_or_grow(size_t len) {
+	do {
+		if (len <= heap_free_units) {
+			const size_t start=heap_take(len);
+			if (start!=NO_UNIT)
+				return start;
+		}
+#ifdef TWR_MALLOC_THREADS
+		// before growing, give back the blocks this thread has cached
+		thread_cache_release();
+		if (len <= heap_free_units) {
+			const size_t start=heap_take(len);
+			if (start!=NO_UNIT)
+				return start;
+		}
+#endif
+	} while (heap_grow(len));
+
+	return NO_UNIT;
+}
+
+/************************************************/
+
+// When the heap can't satisfy an allocation (even after growing), the registered memory pressure handlers are called,
+// and if any of them freed memory, the allocation is tried again.  Handlers are called in the order they were registered,
+// without heap_lock held, so that they can call free().  An allocation made by a handler doesn't call the handlers again.
+
+#define MAX_MEMORY_PRESSURE_HANDLERS 16
+
+static twr_memory_pressure_handler_t memory_pressure_handlers[MAX_MEMORY_PRESSURE_HANDLERS];
+static int memory_pressure_handler_count;
+#ifdef TWR_MALLOC_THREADS
+static _Thread_local bool in_memory_pressure;
+#else
+static bool in_memory_pressure;
+#endif
+
+// returns false if MAX_MEMORY_PRESSURE_HANDLERS are already registered
+bool twr_register_memory_pressure_handler(twr_memory_pressure_handler_t handler) {
+	bool registered=false;
+	LOCK(heap_lock);
+	if (memory_pressure_handler_count<MAX_MEMORY_PRESSURE_HANDLERS) {
+		memory_pressure_handlers[memory_pressure_handler_count++]=handler;
+		registered=true;
+	}
+	UNLOCK(heap_lock);
+	return registered;
+}
+
+void twr_unregister_memory_pressure_handler(twr_memory_pressure_handler_t handler) {
+	LOCK(heap_lock);
+	for (int i=0; i<memory_pressure_handler_count; i++) {
+		if (memory_pressure_handlers[i]==handler) {
+			memmove(&memory_pressure_handlers[i], &memory_pressure_handlers[i+1], (memory_pressure_handler_count-i-1)*sizeof(twr_memory_pressure_handler_t));
+			memory_pressure_handler_count--;
+			break;
+		}
+	}
+	UNLOCK(heap_lock);
+}
+
+// call the handlers, and return true if they freed any memory.  heap_lock must not be held.
+static bool memory_pressure(size_t size) {
+	if (in_memory_pressure) return false;
+
+	twr_memory_pressure_handler_t handlers[MAX_MEMORY_PRESSURE_HANDLERS];
+	LOCK(heap_lock);
+	const int count=memory_pressure_handler_count;
+	memcpy(handlers, memory_pressure_handlers, count*sizeof(twr_memory_pressure_handler_t));
+	UNLOCK(heap_lock);
+
+	in_memory_pressure=true;
+	size_t freed=0;
+	for (int i=0; i<count; i++)
+		freed+=handlers[i](size);
+	in_memory_pressure=false;
+
+	return freed>0;
+}
+
+/************************************************/
+
+// Allocations of more than large_object_threshold bytes (image data, audio buffers, etc.) are made from a separate large
+// object space, so that these long lived blocks don't fragment the space used by small allocations.
+// The large object space is a list of segments.  Each segment is taken from the heap as one block (with LARGE_SEGMENT_MARKER
+// in place of VALID_MALLOC_MARKER) and is divided into LARGE_PAGE_SIZE pages, with a bitmap of allocated pages.
+// A large allocation is a run of pages that starts with the usual header, except with LARGE_MALLOC_MARKER.
+// A segment is returned to the heap when its last allocation is freed.
+
+#define LARGE_OBJECT_THRESHOLD (64*1024)
+#define LARGE_PAGE_SIZE 4096
+#define LARGE_PAGE_UNITS (LARGE_PAGE_SIZE/ALLOC_SIZE)
+#define LARGE_SEGMENT_MIN_PAGES 64  // a new segment is at least 256KB, if the heap has twice that free
+#define LARGE_MALLOC_MARKER (0x1A46E0B7)
+#define LARGE_SEGMENT_MARKER (0x5E6E0B75)
+
+struct large_segment {
+	struct large_segment* next;
+	uint64_t* pages;       // first page
+	size_t num_pages;
+	size_t free_pages;
+	uint64_t page_map[];   // bit is 1 for allocated pages
+};
+
+static struct large_segment* large_segments;
+static size_t large_allocation_count;
+
+// variables so that the unit test can use the large object space in a small heap
+static size_t large_object_threshold=LARGE_OBJECT_THRESHOLD;
+static size_t large_segment_min_pages=LARGE_SEGMENT_MIN_PAGES;
+
+static inline size_t large_pages(size_t size_in_alloc_units) {
+	return (size_in_alloc_units+HEADER_UNITS+LARGE_PAGE_UNITS-1)/LARGE_PAGE_UNITS;
+}
+
+static inline bool is_large_alloc(void* mem) {
+	const size_t addr=(uint64_t*)mem-heap;
+	return addr>=HEADER_UNITS && addr<heap_size_in_alloc_units && heap[addr-2]==LARGE_MALLOC_MARKER;
+}
+
+static inline bool is_page_free(struct large_segment* seg, size_t page) {
+	return ((seg->page_map[page>>6]>>(page&63))&1)==0;
+}
+
+static void set_page_state(struct large_segment* seg, size_t first, size_t n, bool do_alloc) {
+	for (size_t p=first; p<first+n; p++) {
+		if (do_alloc)
+			seg->page_map[p>>6]|=1ULL<<(p&63);
+		else
+			seg->page_map[p>>6]&=~(1ULL<<(p&63));
+	}
+	if (do_alloc)
+		seg->free_pages-=n;
+	else
+		seg->free_pages+=n;
+}
+
+// first page of a run of n free pages, or NO_UNIT
+static size_t segment_find_pages(struct large_segment* seg, size_t n) {
+	if (seg->free_pages<n) return NO_UNIT;
+
+	size_t run=0;
+	for (size_t p=0; p<seg->num_pages; p++) {
+		if (!is_page_free(seg, p))
+			run=0;
+		else if (++run==n)
+			return p+1-n;
+	}
+	return NO_UNIT;
+}
+
+static struct large_segment* segment_create(size_t min_pages) {
+	size_t num_pages=min_pages;
+	if (num_pages<large_segment_min_pages && heap_free_units>=2*large_segment_min_pages*LARGE_PAGE_UNITS)
+		num_pages=large_segment_min_pages;
+
+	while (true) {
+		const size_t map_words=(num_pages+63)/64;
+		const size_t desc_units=(sizeof(struct large_segment)+map_words*sizeof(uint64_t)+ALLOC_SIZE-1)/ALLOC_SIZE;
+		const size_t size_in_alloc_units=desc_units+num_pages*LARGE_PAGE_UNITS;
+		const size_t start=heap_take_or_grow(size_in_alloc_units+HEADER_UNITS);
+
+		if (start!=NO_UNIT) {
+			heap[start]=LARGE_SEGMENT_MARKER;
+			heap[start+1]=size_in_alloc_units;
+			struct large_segment* seg=(struct large_segment*)&heap[start+HEADER_UNITS];
+			seg->pages=&heap[start+HEADER_UNITS+desc_units];
+			seg->num_pages=num_pages;
+			seg->free_pages=num_pages;
+			memset(seg->page_map, 0, map_words*sizeof(uint64_t));
+			seg->next=large_segments;
+			large_segments=seg;
+			return seg;
+		}
+
+		if (num_pages==min_pages) return NULL;
+		num_pages=min_pages;  // a bigger segment didn't fit, so try for just what is needed
+	}
+}
+
+static void segment_destroy(struct large_segment* seg) {
+	struct large_segment** link=&large_segments;
+	while (*link!=seg) link=&(*link)->next;
+	*link=seg->next;
+
+	const size_t start=(uint64_t*)seg-heap-HEADER_UNITS;
+	assert(heap[start]==LARGE_SEGMENT_MARKER);
+	heap[start]=0xDEADBEEFDEADBEEF;
+	heap_release(start, heap[start+1]+HEADER_UNITS);
+}
+
+static struct large_segment* large_segment_of(void* mem) {
+	for (struct large_segment* seg=large_segments; seg; seg=seg->next)
+		if ((uint64_t*)mem>seg->pages && (uint64_t*)mem<seg->pages+seg->num_pages*LARGE_PAGE_UNITS)
+			return seg;
+	return NULL;
+}
+
+// heap_lock must be held
+static void* large_take(size_t size_in_alloc_units) {
+	const size_t n=large_pages(size_in_alloc_units);
+	struct large_segment* seg;
+	size_t page=NO_UNIT;
+
+	for (seg=large_segments; seg; seg=seg->next)
+		if ((page=segment_find_pages(seg, n))!=NO_UNIT)
+			break;
+
+	if (seg==NULL) {
+		seg=segment_create(n);
+		if (seg==NULL) return NULL;
+		page=0;
+	}
+
+	set_page_state(seg, page, n, true);
+	uint64_t* header=seg->pages+page*LARGE_PAGE_UNITS;
+	header[0]=LARGE_MALLOC_MARKER;
+	header[1]=size_in_alloc_units;
+	large_allocation_count++;
+	if (heap_profiling) profile_alloc(size_in_alloc_units);
+
+	return &header[HEADER_UNITS];
+}
+
+// heap_lock must be held.  returns false if mem is not a valid large allocation
+static bool large_release(void* mem) {
+	struct large_segment* seg=large_segment_of(mem);
+	uint64_t* header=(uint64_t*)mem-HEADER_UNITS;
+	if (seg==NULL || (header-seg->pages)%LARGE_PAGE_UNITS!=0)
+		return false;
+
+	const size_t page=(header-seg->pages)/LARGE_PAGE_UNITS;
+	const size_t size_in_alloc_units=header[1];
+	const size_t n=large_pages(size_in_alloc_units);
+	if (is_page_free(seg, page) || page+n>seg->num_pages)
+		return false;
+
+	header[0]=0xDEADBEEFDEADBEEF;  // so a double free is caught
+	set_page_state(seg, page, n, false);
+	large_allocation_count--;
+	if (heap_profiling) profile_free(size_in_alloc_units);
+
+	if (seg->free_pages==seg->num_pages)
+		segment_destroy(seg);
+
+	return true;
+}
+
+// heap_lock must be held.  resize a large allocation where it is, if the pages that follow it are free
+static bool large_resize(void* mem, size_t new_units) {
+	struct large_segment* seg=large_segment_of(mem);
+	uint64_t* header=(uint64_t*)mem-HEADER_UNITS;
+	const size_t page=(header-seg->pages)/LARGE_PAGE_UNITS;
+	const size_t old_units=header[1];
+	const size_t old_n=large_pages(old_units);
+	const size_t new_n=large_pages(new_units);
+
+	if (new_n>old_n) {
+		if (page+new_n>seg->num_pages) return false;
+		for (size_t p=page+old_n; p<page+new_n; p++)
+			if (!is_page_free(seg, p)) return false;
+		set_page_state(seg, page+old_n, new_n-old_n, true);
+	}
+	else if (new_n<old_n) {
+		set_page_state(seg, page+new_n, old_n-new_n, false);
+	}
+
+	header[1]=new_units;
+	if (heap_profiling) profile_resize(old_units, new_units);
+	return true;
+}
+
+static void large_debug_stats(twr_ioconsole_t* outcon) {
+	for (struct large_segment* seg=large_segments; seg; seg=seg->next)
+		io_printf(outcon, "   large object segment at 0x%x: %d pages, %d free\n", seg->pages, seg->num_pages, seg->free_pages);
+	io_printf(outcon, "   large objects: %d\n", large_allocation_count);
+}
+
+// call fn for the size of each large allocation
+static void large_for_each(void (*fn)(size_t size_in_alloc_units)) {
+	for (struct large_segment* seg=large_segments; seg; seg=seg->next) {
+		size_t p=0;
+		while (p<seg->num_pages) {
+			if (is_page_free(seg, p)) {
+				p++;
+			}
+			else {
+				const size_t units=seg->pages[p*LARGE_PAGE_UNITS+1];
+				fn(units);
+				p+=large_pages(units);
+			}
+		}
+	}
+}
+
 /************************************************/
 //Regular malloc aligns memory suitable for any object type with a fundamental alignment. 
 // this implementation aligns on ALLOC_SIZE==8, which matches max_align_t which is defined as double 
@@ -138,10 +1076,6 @@ static size_t malloc_units(void *mem) {
 __attribute__((export_name("malloc")))
 #endif
 void *malloc(size_t size) {
-	size_t size_in_alloc_units = (size+ALLOC_SIZE-1)/ALLOC_SIZE;
-	size_t start=0;
-	size_t len;
-	
 	//twr_conlog("malloc entry size %d",size);
 	//twr_conlog("malloc avail is %d",avail());
 
@@ -150,16 +1084,42 @@ void *malloc(size_t size) {
 		return NULL;
 	}
 
-	while (find_next_free_chunk(&start, &len)) {
-		if (len >= (size_in_alloc_units+2)) {
+	if (size>SIZE_MAX-ALLOC_SIZE)  // rounding up to ALLOC_SIZE units would wrap
+		return NULL;
+
+	const size_t size_in_alloc_units = (size+ALLOC_SIZE-1)/ALLOC_SIZE;
+
+	if (size>large_object_threshold) {
+		do {
+			LOCK(heap_lock);
+			void* mem=large_take(size_in_alloc_units);
+			UNLOCK(heap_lock);
+			if (mem) return mem;
+		} while (memory_pressure(size));
+		twr_conlog("malloc failed to alloc large object of size %d, note avail mem is %d",size,avail());
+		return 0;
+	}
+
+#ifdef TWR_MALLOC_THREADS
+	if (size_in_alloc_units<=THREAD_CACHE_CLASSES) {
+		void* mem=thread_cache_take(size_in_alloc_units);
+		if (mem) return mem;
+	}
+#endif
+
+	do {
+		LOCK(heap_lock);
+		const size_t start=heap_take_or_grow(size_in_alloc_units+HEADER_UNITS);
+		if (start!=NO_UNIT) {
 			take_some_memory(start, size_in_alloc_units);
+			UNLOCK(heap_lock);
 			//twr_conlog("malloc returns %x",(void *)&(heap[start+2]));
-			const uintptr_t mem = (uintptr_t)(&(heap[start+2]));
+			const uintptr_t mem = (uintptr_t)(&(heap[start+HEADER_UNITS]));
 			assert( ( (mem) & 7)==0);  // assert 8 byte aligned
 			return (void *)mem;  /* first memory alloc unit is VALID_MALLOC_MARKER, 2nd is used for size of allocation */
 		}
-		start=start+len;
-	}
+		UNLOCK(heap_lock);
+	} while (memory_pressure(size));
 
 	twr_conlog("malloc failed to alloc mem of size %d, note avail mem is %d",size,avail());
 
@@ -170,25 +1130,79 @@ void *malloc(size_t size) {
 
 #define min(a, b) ((a)<(b)?(a):(b))
 
-// makes no attempt to actually expand or contract current mem block.
-// a deficiency
+static int validate_header(char* msg, void* mem);
+
+// a block is shrunk in place by returning its tail to the heap, and grown in place if the units that follow it are free.
+// otherwise a new block is allocated and the contents copied.
 void *realloc( void *ptr, size_t new_size ) {
-	void* newptr=malloc(new_size);
-	if (newptr) {
-		if (ptr) {
+	if (ptr==NULL || new_size==0)
+		return malloc(new_size);
+
+	if (new_size>SIZE_MAX-ALLOC_SIZE)  // rounding up to ALLOC_SIZE units would wrap
+		return NULL;
+
+	// a large object is resized in place if it stays large and the following pages are free, otherwise it is moved
+	if (is_large_alloc(ptr)) {
+		const size_t new_units=(new_size+ALLOC_SIZE-1)/ALLOC_SIZE;
+		if (new_size>large_object_threshold) {
+			LOCK(heap_lock);
+			const bool resized=large_resize(ptr, new_units);
+			if (resized) realloc_in_place_count++;
+			UNLOCK(heap_lock);
+			if (resized) return ptr;
+		}
+
+		void* newptr=malloc(new_size);
+		if (newptr) {
 			memcpy(newptr, ptr, min(new_size, malloc_units(ptr)*ALLOC_SIZE));
 			free(ptr);
+			LOCK(heap_lock);
+			realloc_moved_count++;
+			UNLOCK(heap_lock);
 		}
 		return newptr;
 	}
-	return NULL;
-}
-/************************************************/
 
-void bzero (void *to, size_t count) {
-	memset(to, 0, count);  
-}
+	if (!validate_header("in realloc", ptr)) {
+		twr_conlog("error in realloc(%x)", ptr);
+		return NULL;
+	}
 
+	const size_t addr=(uint64_t*)ptr-heap;
+	const size_t old_units=malloc_units(ptr);
+	const size_t new_units=(new_size+ALLOC_SIZE-1)/ALLOC_SIZE;
+
+	LOCK(heap_lock);
+	if (new_units<=old_units) {
+		if (new_units<old_units) {
+			heap[addr-1]=new_units;
+			heap_release(addr+new_units, old_units-new_units);
+			if (heap_profiling) profile_resize(old_units, new_units);
+		}
+		realloc_in_place_count++;
+		UNLOCK(heap_lock);
+		return ptr;
+	}
+
+	if (heap_take_at(addr+old_units, new_units-old_units)) {
+		heap[addr-1]=new_units;
+		if (heap_profiling) profile_resize(old_units, new_units);
+		realloc_in_place_count++;
+		UNLOCK(heap_lock);
+		return ptr;
+	}
+	UNLOCK(heap_lock);
+
+	void* newptr=malloc(new_size);
+	if (newptr) {
+		memcpy(newptr, ptr, min(new_size, old_units*ALLOC_SIZE));
+		free(ptr);
+		LOCK(heap_lock);
+		realloc_moved_count++;
+		UNLOCK(heap_lock);
+	}
+	return newptr;
+}
 /************************************************/
 
 void* calloc( size_t num, size_t size ) {
@@ -197,6 +1211,9 @@ void* calloc( size_t num, size_t size ) {
 	if (num == 0 || size == 0)
 		num = size = 1;
 
+	if (num > SIZE_MAX/size)  // num*size would overflow
+		return NULL;
+
 	ptr = malloc (num * size);
 	if (ptr) bzero (ptr, num * size);
 
@@ -206,13 +1223,69 @@ void* calloc( size_t num, size_t size ) {
 /************************************************/
 
 // Regular malloc aligns memory suitable for any object type with a fundamental alignment. 
-// The aligned_alloc is useful for over-aligned allocations, such as to SSE, cache line, or VM page boundary.
-// Which this simple version doesn't support
+// The aligned_alloc is useful for over-aligned allocations, such as to SIMD, cache line, or VM page boundary.
+// alignment must be a power of 2, up to MAX_ALIGNMENT (the Wasm page size).
+// libc++ aligned operator new (eg. new of an alignas(64) type) calls aligned_alloc.
+
+#define MAX_ALIGNMENT (64*1024)
 
 void *aligned_alloc( size_t alignment, size_t size ) {
-	if (alignment<1 || alignment > ALLOC_SIZE) return NULL;
+	if (alignment<1 || (alignment&(alignment-1))!=0 || alignment > MAX_ALIGNMENT) return NULL;
+
+	if (alignment <= ALLOC_SIZE || size==0) 
+		return malloc(size);
+
+	if (size>SIZE_MAX-ALLOC_SIZE)  // rounding up to ALLOC_SIZE units would wrap
+		return NULL;
+
+	// allocate enough extra units that an aligned address is in the block, then give back the units before and after the aligned allocation.
+	// the allocation header goes right before the aligned memory, so free() and realloc() work as usual.
+	const size_t size_in_alloc_units = (size+ALLOC_SIZE-1)/ALLOC_SIZE;
+	const size_t len=size_in_alloc_units+HEADER_UNITS+alignment/ALLOC_SIZE-1;
+
+	size_t start;
+	while (true) {
+		LOCK(heap_lock);
+		start=heap_take_or_grow(len);
+		if (start!=NO_UNIT) break;  // with heap_lock held
+		UNLOCK(heap_lock);
+		if (!memory_pressure(len*ALLOC_SIZE)) {
+			twr_conlog("aligned_alloc failed to alloc mem of size %d aligned to %d, note avail mem is %d",size,alignment,avail());
+			return NULL;
+		}
+	}
+
+	const uintptr_t first=(uintptr_t)(&heap[start+HEADER_UNITS]);
+	const uintptr_t mem=(first+alignment-1)&~(uintptr_t)(alignment-1);
+	const size_t lead=(mem-first)/ALLOC_SIZE;
+	const size_t used=lead+HEADER_UNITS+size_in_alloc_units;
+
+	if (lead>0)
+		heap_release(start, lead);
+	if (used<len)
+		heap_release(start+used, len-used);
+
+	take_some_memory(start+lead, size_in_alloc_units);
+	UNLOCK(heap_lock);
+	assert((mem&(alignment-1))==0);
+	return (void *)mem;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+	if ((alignment%sizeof(void*))!=0 || (alignment&(alignment-1))!=0 || alignment > MAX_ALIGNMENT) 
+		return EINVAL;
+
+	if (size==0) {
+		*memptr=NULL;
+		return 0;
+	}
+
+	void* mem=aligned_alloc(alignment, size);
+	if (mem==NULL) 
+		return ENOMEM;
 
-	return malloc(size);
+	*memptr=mem;
+	return 0;
 }
 
 /************************************************/
@@ -250,6 +1323,15 @@ void free(void *mem) {
 	if (mem==NULL) {
 		return;
 	}
+
+	if (is_large_alloc(mem)) {
+		LOCK(heap_lock);
+		const bool released=large_release(mem);
+		UNLOCK(heap_lock);
+		if (!released)
+			twr_conlog("error in free(%x) - invalid large object", mem);
+		return;
+	}
 	
 	if (!validate_header("in free", mem)) {
 		twr_conlog("error in free(%x)", mem);
@@ -259,29 +1341,290 @@ void free(void *mem) {
 	size_t addr=(uint64_t*)mem-heap;
 	size_t size_in_alloc_units=heap[addr-1];
 
-	for (int i=-2; i < (int)size_in_alloc_units; i++) {
-		if (is_alloc_unit_free(addr+i)) {
-			twr_conlog("error in free(%d) - internal error - memory incorrectly marked as free", addr);
-			return;
+#ifdef TWR_MALLOC_THREADS
+	if (size_in_alloc_units<=THREAD_CACHE_CLASSES && thread_cache_put(addr-HEADER_UNITS, size_in_alloc_units))
+		return;
+#endif
+
+	LOCK(heap_lock);
+	if (!is_range_state(addr-HEADER_UNITS, size_in_alloc_units+HEADER_UNITS, 1)) {
+		UNLOCK(heap_lock);
+		twr_conlog("error in free(%d) - internal error - memory incorrectly marked as free", addr);
+		return;
+	}
+
+	heap[addr-2]=0xDEADBEEFDEADBEEF;  // so a double free fails validate_header
+	heap_release(addr-HEADER_UNITS, size_in_alloc_units+HEADER_UNITS);
+	if (heap_profiling) profile_free(size_in_alloc_units);
+	UNLOCK(heap_lock);
+}
+
+/************************************************/
+
+// twr_halloc allocates a relocatable block, which is referred to by a handle rather than a pointer.
+// While a block is unlocked, twr_heap_compact() may move it, so its address must be fetched again with twr_hlock().
+// A handle is an index (plus one) into handle_table, which holds the heap unit of each block's header.
+// The header is the usual two units, except that the first is HANDLE_MALLOC_MARKER in the upper 32 bits and the
+// handle_table index in the lower 32 bits, so that compaction can find the handle of a block it moves.
+
+#define HANDLE_MALLOC_MARKER (0x4A4DB10CULL)
+#define HANDLE_TABLE_INITIAL_SIZE 16
+
+struct handle_entry {
+	size_t start;       // heap unit of the block's header, or NO_UNIT if the entry is free
+	size_t lock_count;  // for a free entry, the index of the next free entry
+};
+
+static struct handle_entry* handle_table;
+static size_t handle_table_size;
+static size_t handle_first_free=NO_UNIT;
+
+static inline bool is_handle_header(uint64_t header) {
+	return (header>>32)==HANDLE_MALLOC_MARKER;
+}
+
+// heap_lock must be held
+static bool handle_table_grow(void) {
+	const size_t new_size=handle_table_size?handle_table_size*2:HANDLE_TABLE_INITIAL_SIZE;
+	const size_t size_in_alloc_units=(new_size*sizeof(struct handle_entry)+ALLOC_SIZE-1)/ALLOC_SIZE;
+	const size_t start=heap_take_or_grow(size_in_alloc_units+HEADER_UNITS);
+	if (start==NO_UNIT) return false;
+
+	take_some_memory(start, size_in_alloc_units);
+	struct handle_entry* table=(struct handle_entry*)&heap[start+HEADER_UNITS];
+
+	if (handle_table) {
+		memcpy(table, handle_table, handle_table_size*sizeof(struct handle_entry));
+		const size_t old_start=(uint64_t*)handle_table-heap-HEADER_UNITS;
+		const size_t old_units=heap[old_start+1];
+		heap[old_start]=0xDEADBEEFDEADBEEF;
+		heap_release(old_start, old_units+HEADER_UNITS);
+		if (heap_profiling) profile_free(old_units);
+	}
+
+	for (size_t i=handle_table_size; i<new_size; i++) {
+		table[i].start=NO_UNIT;
+		table[i].lock_count=i+1<new_size?i+1:handle_first_free;
+	}
+	handle_first_free=handle_table_size;
+	handle_table=table;
+	handle_table_size=new_size;
+
+	return true;
+}
+
+static struct handle_entry* handle_entry_of(twr_handle_t h) {
+	if (h==0 || h>handle_table_size || handle_table[h-1].start==NO_UNIT) {
+		twr_conlog("invalid handle %d", h);
+		return NULL;
+	}
+	return &handle_table[h-1];
+}
+
+// returns 0 if the memory can't be allocated
+twr_handle_t twr_halloc(size_t size) {
+	if (size==0) return 0;
+	const size_t size_in_alloc_units=(size+ALLOC_SIZE-1)/ALLOC_SIZE;
+
+	size_t start;
+	while (true) {
+		LOCK(heap_lock);
+		if (handle_first_free!=NO_UNIT || handle_table_grow()) {
+			start=heap_take_or_grow(size_in_alloc_units+HEADER_UNITS);
+			if (start!=NO_UNIT) break;  // with heap_lock held
+		}
+		UNLOCK(heap_lock);
+		if (!memory_pressure(size)) {
+			twr_conlog("twr_halloc failed to alloc mem of size %d, note avail mem is %d",size,avail());
+			return 0;
+		}
+	}
+
+	const size_t index=handle_first_free;
+	handle_first_free=handle_table[index].lock_count;
+	handle_table[index].start=start;
+	handle_table[index].lock_count=0;
+
+	heap[start]=(HANDLE_MALLOC_MARKER<<32)|index;
+	heap[start+1]=size_in_alloc_units;
+	if (heap_profiling) profile_alloc(size_in_alloc_units);
+	UNLOCK(heap_lock);
+
+	return index+1;
+}
+
+// returns the address of the handle's memory, which won't move until the matching twr_hunlock().  Locks nest.
+void* twr_hlock(twr_handle_t h) {
+	LOCK(heap_lock);
+	struct handle_entry* e=handle_entry_of(h);
+	void* mem=NULL;
+	if (e) {
+		e->lock_count++;
+		mem=&heap[e->start+HEADER_UNITS];
+	}
+	UNLOCK(heap_lock);
+	return mem;
+}
+
+void twr_hunlock(twr_handle_t h) {
+	LOCK(heap_lock);
+	struct handle_entry* e=handle_entry_of(h);
+	if (e) {
+		assert(e->lock_count>0);
+		if (e->lock_count>0) e->lock_count--;
+	}
+	UNLOCK(heap_lock);
+}
+
+void twr_hfree(twr_handle_t h) {
+	if (h==0) return;
+
+	LOCK(heap_lock);
+	struct handle_entry* e=handle_entry_of(h);
+	if (e) {
+		const size_t size_in_alloc_units=heap[e->start+1];
+		heap[e->start]=0xDEADBEEFDEADBEEF;
+		heap_release(e->start, size_in_alloc_units+HEADER_UNITS);
+		if (heap_profiling) profile_free(size_in_alloc_units);
+		e->start=NO_UNIT;
+		e->lock_count=handle_first_free;
+		handle_first_free=h-1;
+	}
+	UNLOCK(heap_lock);
+}
+
+// slide each unlocked handle block down into the free run in front of it, so that free memory is merged into larger runs.
+// blocks allocated with malloc (and locked handles) don't move, and so compaction is most effective when the long lived
+// blocks of a program are handles.  Returns the number of bytes moved.
+#ifdef __wasm__
+__attribute__((export_name("twr_heap_compact")))
+#endif
+size_t twr_heap_compact(void) {
+	size_t moved=0;
+
+	LOCK(heap_lock);
+#ifdef TWR_MALLOC_THREADS
+	thread_cache_release();
+#endif
+
+	size_t i=map_find_free(0);
+	while (i<heap_size_in_alloc_units) {
+		const size_t next=map_find_allocated(i, heap_size_in_alloc_units);  // the block after the free run i..next-1
+		if (next==heap_size_in_alloc_units) break;
+
+		const size_t len=heap[next+1]+HEADER_UNITS;
+		const uint64_t header=heap[next];
+		if (is_handle_header(header) && handle_table[header&0xFFFFFFFF].lock_count==0) {
+			const size_t gap=next-i;
+			heap_take_at(i, gap);
+			memmove(&heap[i], &heap[next], len*ALLOC_SIZE);
+			heap_release(i+len, gap);
+			handle_table[header&0xFFFFFFFF].start=i;
+			moved+=len*ALLOC_SIZE;
+			i+=len;  // the free run now follows the moved block
+		}
+		else {
+			i=map_find_free(next+len);
 		}
-		set_free_state(addr+i, 0);
-		heap[addr+i]=0xDEADBEEFDEADBEEF;
 	}
+
+	UNLOCK(heap_lock);
+	return moved;
 }
 
 /************************************************/
 
+// with TWR_MALLOC_THREADS, the calling thread's cached blocks are returned to the heap first (blocks cached by other threads are not counted as free)
 size_t avail() {
-	//twr_conlog("in AVAIL heap_size_in_alloc_units set to %d",heap_size_in_alloc_units);
+#ifdef TWR_MALLOC_THREADS
+	twr_malloc_thread_flush();
+#endif
+	return heap_free_units*ALLOC_SIZE;
+}
+
+/************************************************/
+
+// size in bytes of the largest free run, which is the largest malloc that can succeed without growing the heap
+static size_t largest_free_run(void) {
+	size_t largest=0;
+	size_t i=map_find_free(0);
+	while (i<heap_size_in_alloc_units) {
+		const size_t end=map_find_allocated(i, heap_size_in_alloc_units);
+		if (end-i>largest) largest=end-i;
+		i=map_find_free(end);
+	}
+	return largest*ALLOC_SIZE;
+}
+
+// turn heap profiling on or off.  When turned on, the counts of live allocations are taken from the current heap,
+// and the peak and total counts restart.
+#ifdef __wasm__
+__attribute__((export_name("twr_heap_profile")))
+#endif
+void twr_heap_profile(bool enable) {
+	LOCK(heap_lock);
+	if (enable && !heap_profiling) {
+		memset(&heap_profile, 0, sizeof(heap_profile));
+		size_t i=map_find_allocated(0, heap_size_in_alloc_units);
+		while (i<heap_size_in_alloc_units) {
+			const size_t units=heap[i+1];
+			if (heap[i]==LARGE_SEGMENT_MARKER) {
+				// the large allocations in the segment are added below
+			}
+#ifdef TWR_MALLOC_THREADS
+			else if (heap[i]==THREAD_CACHED_MARKER) {
+			}
+#endif
+			else {
+				assert(heap[i]==VALID_MALLOC_MARKER || is_handle_header(heap[i]));
+				profile_alloc(units);
+			}
+			i=map_find_allocated(i+HEADER_UNITS+units, heap_size_in_alloc_units);
+		}
+		large_for_each(profile_alloc);
+		heap_profile.total_allocations=0;
+	}
+	heap_profiling=enable;
+	UNLOCK(heap_lock);
+}
 
-	size_t avail=0;
-	for (size_t i=0; i < heap_size_in_alloc_units; i++) {
-		//twr_conlog("%d, ",i);
-		if (is_alloc_unit_free(i))
-			avail++;
+// fill in *stats.  The live, peak, and count fields are only valid if profiling is on (stats->profiling is true)
+#ifdef __wasm__
+__attribute__((export_name("twr_heap_stats")))
+#endif
+void twr_heap_stats(struct twr_heap_stats* stats) {
+#ifdef TWR_MALLOC_THREADS
+	twr_malloc_thread_flush();
+#endif
+	LOCK(heap_lock);
+	if (heap_profiling)
+		*stats=heap_profile;
+	else
+		memset(stats, 0, sizeof(*stats));
+
+	stats->profiling=heap_profiling;
+	stats->heap_size=heap_size_in_bytes;
+	stats->free_bytes=heap_free_units*ALLOC_SIZE;
+	stats->largest_free_run=largest_free_run();
+	for (struct large_segment* seg=large_segments; seg; seg=seg->next) {
+		stats->large_segments++;
+		stats->large_space_bytes+=seg->num_pages*LARGE_PAGE_SIZE;
+		stats->large_free_bytes+=seg->free_pages*LARGE_PAGE_SIZE;
 	}
+	stats->large_allocations=large_allocation_count;
+	UNLOCK(heap_lock);
+	// 0 when all free memory is in one run, approaching 1 as free memory is split into many small runs
+	stats->fragmentation=stats->free_bytes==0?0:1.0-(double)stats->largest_free_run/(double)stats->free_bytes;
+}
 
-	return avail*ALLOC_SIZE;
+// used by JavaScript (getHeapStats), which would change the stats if it malloc'd the struct
+#ifdef __wasm__
+__attribute__((export_name("twr_heap_stats_static")))
+#endif
+struct twr_heap_stats* twr_heap_stats_static(void) {
+	static struct twr_heap_stats stats;
+	twr_heap_stats(&stats);
+	return &stats;
 }
 
 /************************************************/
@@ -303,14 +1646,151 @@ static int validate_malloc(char* msg, void* mem, size_t size) {
 	return 1;
 }
 
+// check that a large object segment is in the segment list, and that its page map matches its allocations
+static int validate_segment(char* msg, struct large_segment* seg, size_t size_in_alloc_units) {
+	struct large_segment* s;
+	for (s=large_segments; s && s!=seg; s=s->next);
+	if (s==NULL) {
+		twr_conlog("%s - validate_segment fail: segment 0x%x is not in the list", msg, seg);
+		return 0;
+	}
+
+	if (seg->pages+seg->num_pages*LARGE_PAGE_UNITS != (uint64_t*)seg+size_in_alloc_units) {
+		twr_conlog("%s - validate_segment fail: segment 0x%x has the wrong size", msg, seg);
+		return 0;
+	}
+
+	size_t p=0, free_pages=0;
+	while (p<seg->num_pages) {
+		if (is_page_free(seg, p)) {
+			free_pages++;
+			p++;
+		}
+		else {
+			const uint64_t* header=seg->pages+p*LARGE_PAGE_UNITS;
+			const size_t n=large_pages(header[1]);
+			if (header[0]!=LARGE_MALLOC_MARKER || header[1]<=large_object_threshold/ALLOC_SIZE || p+n>seg->num_pages) {
+				twr_conlog("%s - validate_segment fail: bad large allocation header at page %d", msg, p);
+				return 0;
+			}
+			for (size_t k=p; k<p+n; k++) {
+				if (is_page_free(seg, k)) {
+					twr_conlog("%s - validate_segment fail: large allocation at page %d is marked as free", msg, p);
+					return 0;
+				}
+			}
+			p+=n;
+		}
+	}
+
+	if (free_pages!=seg->free_pages || free_pages==seg->num_pages) {
+		twr_conlog("%s - validate_segment fail: free page count is %d, expected %d", msg, seg->free_pages, free_pages);
+		return 0;
+	}
+
+	return 1;
+}
+
+// walk the entire heap, checking that every allocation header, heap_map bit, and free range is consistent
+static int validate_heap(char* msg) {
+	size_t i=0;
+	size_t free_units=0;
+
+	while (i < heap_size_in_alloc_units) {
+		if (is_alloc_unit_free(i)) {
+			size_t run=i;
+			while (run < heap_size_in_alloc_units && is_alloc_unit_free(run))
+				run++;
+			run=run-i;
+#ifndef TWR_MALLOC_FIRST_FIT
+			if ((heap[i]>>32)!=FREE_RANGE_MARKER || range_tag_len(heap[i])!=run || heap[i+run-1]!=heap[i]) {
+				twr_conlog("%s - validate_heap fail: bad free range tags at unit %d", msg, i);
+				return 0;
+			}
+			if (run>=MIN_BIN_RANGE_UNITS) {
+				uint32_t r;
+				const int b=bin_index(run);
+				for (r=bin_is_empty(b)?NO_UNIT:bin_head[b]; r!=NO_UNIT && r!=i; r=range_next(r));
+				if (r!=i) {
+					twr_conlog("%s - validate_heap fail: free range at unit %d is not in its bin", msg, i);
+					return 0;
+				}
+			}
+#endif
+			free_units+=run;
+			i+=run;
+		}
+		else {
+			if (heap[i]==LARGE_SEGMENT_MARKER) {
+				if (!validate_segment(msg, (struct large_segment*)&heap[i+HEADER_UNITS], heap[i+1]))
+					return 0;
+			}
+			else if (is_handle_header(heap[i])) {
+				const size_t index=heap[i]&0xFFFFFFFF;
+				if (index>=handle_table_size || handle_table[index].start!=i || heap[i+1]<1 || heap[i+1]>heap_size_in_alloc_units-HEADER_UNITS) {
+					twr_conlog("%s - validate_heap fail: bad handle block at unit %d", msg, i);
+					return 0;
+				}
+			}
+#ifdef TWR_MALLOC_THREADS
+			else if (heap[i]==THREAD_CACHED_MARKER) {
+			}
+#endif
+			else if (!validate_header(msg, &heap[i+HEADER_UNITS]))
+				return 0;
+			const size_t len=heap[i+1]+HEADER_UNITS;
+			for (size_t k=0; k<len; k++) {
+				if (is_alloc_unit_free(i+k)) {
+					twr_conlog("%s - validate_heap fail: allocation at unit %d is marked as free", msg, i);
+					return 0;
+				}
+			}
+			i+=len;
+		}
+	}
+
+	for (size_t w=0; w<heap_map_words; w++) {
+		const bool nonfull=(map_nonfull[w>>6]>>(w&63))&1;
+		if (nonfull != (heap_map[w]!=~0ULL)) {
+			twr_conlog("%s - validate_heap fail: map_nonfull is wrong for map word %d", msg, w);
+			return 0;
+		}
+	}
+
+	for (size_t s=0; s<map_nonfull_words; s++) {
+		const bool nonzero=(map_nonfull2[s>>6]>>(s&63))&1;
+		if (nonzero != (map_nonfull[s]!=0)) {
+			twr_conlog("%s - validate_heap fail: map_nonfull2 is wrong for map_nonfull word %d", msg, s);
+			return 0;
+		}
+	}
+
+	if (free_units!=heap_free_units) {
+		twr_conlog("%s - validate_heap fail: free unit count is %d, expected %d", msg, heap_free_units, free_units);
+		return 0;
+	}
+
+	return 1;
+}
+
 /********************************************************/
 /********************************************************/
 /********************************************************/
 
+// twr_cache_malloc keeps freed memory in a bin per allocation size (rounded up to ALLOC_SIZE), for fast reuse.
+// bins are found with a hash table indexed by size.  A bin holds at most bin->max_free entries on its free list,
+// after which twr_cache_free returns memory to the heap.  twr_cache_trim() returns all cached memory to the heap.
+
+#define CACHE_HASH_SIZE 64           // must be a power of 2
+#define CACHE_BIN_MAX_BYTES (16*1024)  // a bin caches at most this many bytes of free entries,
+#define CACHE_BIN_MIN_ENTRIES 8        // but always at least this many entries
+
 struct bin {
     size_t size;
-    struct bin *next;
+    struct bin *next;   // next bin in the same hash table slot
     void* first_free_entry;
+    size_t num_free;
+    size_t max_free;
 };
 
 struct bin_entry {
@@ -320,32 +1800,37 @@ struct bin_entry {
 };
 
 struct bin * bin_find(size_t size);
+static size_t cache_memory_pressure(size_t size);
 void* bin_get_mem(struct bin *);
 
-static struct bin * first_bin;
+static struct bin * bin_table[CACHE_HASH_SIZE];
+
+static inline unsigned bin_hash(size_t size) {
+	return (size/ALLOC_SIZE)&(CACHE_HASH_SIZE-1);
+}
 
 struct bin * bin_find(size_t size) {
 
-    struct bin *last=NULL, *b;
+    struct bin *b;
+    const unsigned h=bin_hash(size);
 
-	b=first_bin;
-    while (b) {
+	for (b=bin_table[h]; b; b=b->next)
         if (b->size==size) return b;
-        last=b;
-		b=b->next;
-    }
+
+    static bool registered;
+    if (!registered)
+        registered=twr_register_memory_pressure_handler(cache_memory_pressure);
 
     b=malloc(sizeof(struct bin));
+    if (b==NULL) return NULL;
     b->size=size;
     b->first_free_entry=NULL;
-    b->next=NULL;
+    b->num_free=0;
+    b->max_free=CACHE_BIN_MAX_BYTES/(size+sizeof(struct bin_entry));
+    if (b->max_free<CACHE_BIN_MIN_ENTRIES) b->max_free=CACHE_BIN_MIN_ENTRIES;
+    b->next=bin_table[h];
+    bin_table[h]=b;
 
-    if (last) {
-        last->next=b;
-    }
-    else {
-        first_bin=b;
-    }
     return b;
 }
 
@@ -355,20 +1840,27 @@ void* bin_get_mem(struct bin *b) {
     if (b->first_free_entry==NULL) {
 		assert((sizeof(struct bin_entry)&7)==0); // make sure 8 byte aligned
         be = malloc(sizeof(struct bin_entry)+b->size);
+        if (be==NULL) return NULL;
         be->size=b->size;
 		be->next=NULL;
     }
     else {
         be = b->first_free_entry;
         b->first_free_entry=be->next;
+        b->num_free--;
     }
 
     return &(be[1]);
 }
 
 void bin_return_mem(struct bin *b, struct bin_entry *be) {
+    if (b->num_free>=b->max_free) {
+        free(be);
+        return;
+    }
     be->next=b->first_free_entry;
     b->first_free_entry=be;
+    b->num_free++;
 }
 
 /********************************************************/
@@ -377,18 +1869,68 @@ void bin_return_mem(struct bin *b, struct bin_entry *be) {
 
 void *twr_cache_malloc(size_t size) {
     void* mem;
-    struct bin * b=bin_find(size);
-    mem=bin_get_mem(b);
+    LOCK(cache_lock);
+    struct bin * b=bin_find((size+ALLOC_SIZE_MASK)&~(size_t)ALLOC_SIZE_MASK);
+    mem=b?bin_get_mem(b):NULL;
+    UNLOCK(cache_lock);
+    if (mem==NULL) return NULL;
 	assert( ( ((uintptr_t)mem) & 7)==0);  // assert 8 byte aligned
     return mem;
 }
 
 void twr_cache_free(void* mem) {
+    if (mem==NULL) return;
+
     const char* cmem = (char*)mem;
     struct bin_entry *be=(struct bin_entry*)(cmem-sizeof(struct bin_entry));
 
+    LOCK(cache_lock);
     struct bin * b=bin_find(be->size);
-    bin_return_mem(b, be);
+    if (b==NULL)
+        free(be);
+    else
+        bin_return_mem(b, be);
+    UNLOCK(cache_lock);
+}
+
+// cache_lock must be held
+static size_t cache_trim(void) {
+    size_t released=0;
+
+    for (int h=0; h<CACHE_HASH_SIZE; h++) {
+        for (struct bin *b=bin_table[h]; b; b=b->next) {
+            struct bin_entry *be=b->first_free_entry;
+            while (be) {
+                struct bin_entry *next=be->next;
+                released+=sizeof(struct bin_entry)+be->size;
+                free(be);
+                be=next;
+            }
+            b->first_free_entry=NULL;
+            b->num_free=0;
+        }
+    }
+
+    return released;
+}
+
+// return all memory on the twr_cache_malloc free lists to the heap.  Returns the number of bytes released.
+size_t twr_cache_trim(void) {
+    LOCK(cache_lock);
+    const size_t released=cache_trim();
+    UNLOCK(cache_lock);
+    return released;
+}
+
+// the cache is trimmed when malloc runs out of memory.  If the memory pressure is from a twr_cache_malloc on another
+// thread (which holds cache_lock), the cache is left alone.
+static size_t cache_memory_pressure(size_t size) {
+    size_t released=0;
+    if (TRY_LOCK(cache_lock)) {
+        released=cache_trim();
+        UNLOCK(cache_lock);
+    }
+    return released;
 }
 
 /********************************************************/
@@ -396,7 +1938,7 @@ void twr_cache_free(void* mem) {
 /************************************************/
 
 #ifndef __wasm__
-static uint64_t myheap[1000]; 
+static uint64_t myheap[8000]; 
 #endif
 
 static void set_mem(void* mem, size_t size, unsigned char val) {
@@ -404,6 +1946,17 @@ static void set_mem(void* mem, size_t size, unsigned char val) {
 		((char*)mem)[i]=val;
 }
 
+static void* test_pressure_block;
+static int test_pressure_calls;
+
+static size_t test_pressure_handler(size_t size) {
+	test_pressure_calls++;
+	if (test_pressure_block==NULL) return 0;
+	free(test_pressure_block);
+	test_pressure_block=NULL;
+	return 1000;
+}
+
 #pragma clang optimize off
 
 int malloc_unit_test() {
@@ -412,7 +1965,7 @@ int malloc_unit_test() {
 		#ifdef __wasm__
 		assert(0);
 		#else
-		twr_init_malloc(myheap, sizeof(myheap));
+		twr_init_malloc(myheap, sizeof(myheap)/2);  // the other half is added to the heap at the end of the tests
 		#endif
 	}
 
@@ -432,6 +1985,13 @@ int malloc_unit_test() {
 		return 0;
 	}
 
+	// sizes that can't be rounded up to ALLOC_SIZE units, and calloc sizes that overflow, fail
+	if (malloc(SIZE_MAX)!=NULL || malloc(SIZE_MAX-ALLOC_SIZE+1)!=NULL || aligned_alloc(64, SIZE_MAX-2)!=NULL
+		|| calloc(SIZE_MAX/16+2, 16)!=NULL || calloc(16, SIZE_MAX/16+2)!=NULL) {
+		twr_conlog("malloc unit test failed on overflowing size");
+		return 0;
+	}
+
 	void* mem;
 	const size_t max_alloc=(heap_size_in_alloc_units-2)*ALLOC_SIZE;
 	if ((mem=malloc(max_alloc))==0) {
@@ -573,6 +2133,38 @@ int malloc_unit_test() {
     if (mem1b!=mem1) return 0;
 }
 
+{
+// twr_cache_free returns memory to the heap past a bin's limit, and twr_cache_trim returns the rest
+    struct bin *b=bin_find(24);
+    const size_t save_max_free=b->max_free;
+    b->max_free=2;
+    twr_cache_trim();
+
+    void* mem1[4];
+    for (int i=0; i<4; i++) {
+        mem1[i]=twr_cache_malloc(21);  // rounded to 24
+        if (!mem1[i]) return 0;
+        set_mem(mem1[i], 21, 0xAA);
+    }
+
+    const size_t sz=avail();
+    for (int i=0; i<4; i++)
+        twr_cache_free(mem1[i]);
+
+    if (b->num_free!=2) return 0;
+    if (avail()!=sz+2*(sizeof(struct bin_entry)+24+HEADER_UNITS*ALLOC_SIZE)) return 0;
+
+    if (twr_cache_malloc(24)!=mem1[1]) return 0;  // most recently cached
+    twr_cache_free(mem1[1]);
+
+    if (twr_cache_trim()<2*(sizeof(struct bin_entry)+24)) return 0;
+    if (b->num_free!=0 || b->first_free_entry!=NULL) return 0;
+    if (avail()!=sz+4*(sizeof(struct bin_entry)+24+HEADER_UNITS*ALLOC_SIZE)) return 0;
+
+    b->max_free=save_max_free;
+    if (!validate_heap("cache trim")) return 0;
+}
+
 {
 // realloc unit tests
 	size_t sz=avail();
@@ -604,9 +2196,361 @@ int malloc_unit_test() {
 	for (int i=0; i<20; i++)
 		if (mem1[i]!=i) return 0;
 
+	// a size too large to round up to ALLOC_SIZE units fails, and leaves the block as it was
+	const size_t sz_before=avail();
+	if (realloc(mem1, SIZE_MAX-2)!=NULL || avail()!=sz_before) return 0;
+	if (validate_malloc("realloc 5", mem1, 20)==0)
+			return 0;
+
+	free(mem1);
+	if (sz!=avail()) return 0;
+}
+
+{
+// in place realloc unit tests
+	const size_t sz=avail();
+	unsigned char* mem1=malloc(40);
+	if (validate_malloc("realloc in place 1", mem1, 40)==0)
+			return 0;
+
+	for (int i=0; i<40; i++)
+		mem1[i]=i;
+
+	// shrinking always happens in place, and returns the tail to the heap
+	const size_t in_place=realloc_in_place_count;
+	unsigned char* mem2=realloc(mem1, 16);
+	if (mem2!=mem1 || validate_malloc("realloc in place 2", mem2, 16)==0)
+			return 0;
+	if (avail()!=sz-(16/ALLOC_SIZE+HEADER_UNITS)*ALLOC_SIZE) return 0;
+
+	// growing happens in place when the units after the block are free
+	const size_t end=(uint64_t*)mem1-heap+16/ALLOC_SIZE;
+	bool next_free=true;
+	for (size_t i=end; i<end+64/ALLOC_SIZE; i++)
+		if (i>=heap_size_in_alloc_units || !is_alloc_unit_free(i)) next_free=false;
+
+	mem2=realloc(mem1, 80);
+	if (validate_malloc("realloc in place 3", mem2, 80)==0)
+			return 0;
+	if (next_free && (mem2!=mem1 || realloc_in_place_count!=in_place+2)) return 0;
+
+	for (int i=0; i<16; i++)
+		if (mem2[i]!=i) return 0;
+
+	if (!validate_heap("realloc in place")) return 0;
+
+	// growing when the next block is allocated moves the block
+	mem1=malloc(8);
+	if (mem1==NULL) return 0;
+	unsigned char* mem3=realloc(mem1, 8);
+	if (mem3!=mem1) return 0;
+	const size_t moved=realloc_moved_count;
+	unsigned char* mem4=malloc(8);
+	const bool next_taken=!is_alloc_unit_free((uint64_t*)mem1-heap+1);
+	mem3=realloc(mem1, 512);
+	if (mem3==NULL) return 0;
+	if (next_taken && realloc_moved_count!=moved+1) return 0;
+
+	free(mem2);
+	free(mem3);
+	free(mem4);
+	if (sz!=avail()) return 0;
+	if (!validate_heap("realloc in place complete")) return 0;
+}
+
+{
+// random mix of allocation sizes and lifetimes, which exercises splitting and coalescing of free memory
+	const size_t sz=avail();
+	const int num_slots=32;
+	unsigned char* slot[num_slots];
+	size_t slot_size[num_slots];
+	uint32_t seed=12345;
+
+	for (int i=0; i<num_slots; i++)
+		slot[i]=NULL;
+
+	for (int pass=0; pass<2000; pass++) {
+		seed=seed*1103515245+12345;
+		const int i=(seed>>16)%num_slots;
+		if (slot[i]) {
+			for (size_t k=0; k<slot_size[i]; k++)
+				if (slot[i][k]!=(unsigned char)(i+k)) return 0;
+			free(slot[i]);
+			slot[i]=NULL;
+		}
+		else {
+			seed=seed*1103515245+12345;
+			slot_size[i]=(seed>>16)%((seed&0x100)?512:64)+1;
+			slot[i]=malloc(slot_size[i]);
+			if (slot[i]==NULL) return 0;
+			for (size_t k=0; k<slot_size[i]; k++)
+				slot[i][k]=(unsigned char)(i+k);
+		}
+		if ((pass&63)==0 && !validate_heap("random mix")) return 0;
+	}
+
+	for (int i=0; i<num_slots; i++)
+		free(slot[i]);
+
+	if (sz!=avail()) return 0;
+	if (!validate_heap("random mix complete")) return 0;
+}
+
+{
+// aligned_alloc unit tests
+	const size_t sz=avail();
+
+	if (aligned_alloc(3, 8)!=NULL || aligned_alloc(2*MAX_ALIGNMENT, 8)!=NULL) return 0;
+
+	void* mem1=aligned_alloc(4, 10);   // fundamental alignments are just malloc
+	if (validate_malloc("aligned_alloc 4", mem1, 10)==0)
+		return 0;
 	free(mem1);
+
+	for (size_t align=16; align<=1024; align=align*2) {
+		void* small=malloc(8);  // so that the heap isn't already aligned
+		unsigned char* mem2=aligned_alloc(align, align+3);
+		if (mem2==NULL || ((uintptr_t)mem2&(align-1))!=0) return 0;
+		if (validate_malloc("aligned_alloc", mem2, align+3)==0)
+			return 0;
+		set_mem(mem2, align+3, 0x5A);
+		if (!validate_heap("aligned_alloc")) return 0;
+
+		mem2=realloc(mem2, 8);  // shrink in place
+		if (mem2==NULL || ((uintptr_t)mem2&(align-1))!=0) return 0;
+
+		free(small);
+		free(mem2);
+	}
+
+	void* mem3;
+	if (posix_memalign(&mem3, 12, 8)!=EINVAL) return 0;
+	if (posix_memalign(&mem3, 32, 8)!=0 || ((uintptr_t)mem3&31)!=0) return 0;
+	free(mem3);
+
+	if (sz!=avail()) return 0;
+	if (!validate_heap("aligned_alloc complete")) return 0;
+}
+
+#ifdef TWR_MALLOC_THREADS
+{
+// per thread cache of small blocks
+	size_t sz=avail();
+	const size_t free_units=heap_free_units;
+	char* mem=malloc(40);
+	char* mem2=malloc(40);
+	free(mem);
+	if (heap_free_units+5+5+HEADER_UNITS*2!=free_units) return 0;  // mem is cached, not returned to the heap
+	if (validate_header("expected fail", mem)) return 0;  // so a double free is caught
+	if (!validate_heap("thread cache")) return 0;
+	if (malloc(40)!=mem) return 0;
+	if (!validate_malloc("thread cache", mem, 40)) return 0;
+	free(mem);
+	free(mem2);
+	twr_malloc_thread_flush();
+	if (heap_free_units!=free_units) return 0;
+
+	// a big block is not cached
+	mem=malloc(THREAD_CACHE_CLASSES*ALLOC_SIZE+1);
+	free(mem);
+	if (heap_free_units!=free_units) return 0;
+
+	if (sz!=avail()) return 0;
+}
+#endif
+
+{
+// large object space
+	const size_t sz=avail();
+	struct twr_heap_stats stats;
+	large_object_threshold=1024;  // so that the large object space can be tested in a small heap
+	large_segment_min_pages=2;
+
+	char* a=malloc(2000);  // 1 page, in a new 2 page segment
+	if (!is_large_alloc(a) || a!=(char*)(large_segments->pages+HEADER_UNITS) || large_segments->num_pages!=2) return 0;
+	set_mem(a, 2000, 0xA1);
+	char* b=malloc(3000);  // the segment's second page
+	if (!is_large_alloc(b) || large_segment_of(b)!=large_segment_of(a) || large_segments->free_pages!=0) return 0;
+	char* c=malloc(5000);  // 2 pages, in a new segment
+	if (!is_large_alloc(c) || large_segment_of(c)==large_segment_of(a)) return 0;
+	char* d=malloc(1000);
+	if (is_large_alloc(d)) return 0;
+	if (!validate_heap("large object space")) return 0;
+	if (realloc(c, SIZE_MAX-2)!=NULL || !is_large_alloc(c)) return 0;
+
+	twr_heap_stats(&stats);
+	if (stats.large_segments!=2 || stats.large_allocations!=3 || stats.large_space_bytes!=4*LARGE_PAGE_SIZE || stats.large_free_bytes!=0) return 0;
+
+	free(b);
+	if (large_segment_of(a)->free_pages!=1) return 0;
+	if (realloc(a, 6000)!=a) return 0;  // grows into the free page
+	if (large_segment_of(a)->free_pages!=0) return 0;
+
+	char* a2=realloc(a, 9000);  // 3 pages don't fit in the segment, so a is moved and its segment returned to the heap
+	if (a2==a || !is_large_alloc(a2) || large_segment_of(a)!=NULL) return 0;
+	for (int i=0; i<2000; i++)
+		if ((unsigned char)a2[i]!=0xA1) return 0;
+	if (!validate_heap("large object space realloc")) return 0;
+
+	char* a3=realloc(a2, 100);  // moved to the small object heap
+	if (is_large_alloc(a3) || large_segment_of(a2)!=NULL) return 0;
+	for (int i=0; i<100; i++)
+		if ((unsigned char)a3[i]!=0xA1) return 0;
+
+	free(a3);
+	free(c);
+	free(d);
+	if (large_segments!=NULL) return 0;
+
+	twr_heap_stats(&stats);
+	if (stats.large_segments!=0 || stats.large_allocations!=0) return 0;
+
+	large_object_threshold=LARGE_OBJECT_THRESHOLD;
+	large_segment_min_pages=LARGE_SEGMENT_MIN_PAGES;
 	if (sz!=avail()) return 0;
+	if (!validate_heap("large object space complete")) return 0;
+}
+
+{
+// relocatable (handle) allocations and compaction
+	const size_t sz=avail();
+	twr_handle_t h[20];
+	void* m[20];
+	void* before[20];
+
+	for (int i=0; i<20; i++) {
+		m[i]=malloc(24+i*8);
+		h[i]=twr_halloc(40+i*8);
+		if (m[i]==NULL || h[i]==0) return 0;
+		set_mem(twr_hlock(h[i]), 40+i*8, i+1);
+		twr_hunlock(h[i]);
+	}
+	if (handle_table_size<20) return 0;
+
+	// free the mallocs, to leave holes between the handle blocks
+	for (int i=0; i<20; i++)
+		free(m[i]);
+
+	for (int i=0; i<20; i++) {
+		before[i]=twr_hlock(h[i]);
+		if (i!=7) twr_hunlock(h[i]);  // h[7] stays locked
+	}
+
+	if (twr_heap_compact()==0) return 0;
+	if (!validate_heap("compact")) return 0;
+
+	for (int i=0; i<20; i++) {
+		unsigned char* mem=twr_hlock(h[i]);
+		for (int k=0; k<40+i*8; k++)
+			if (mem[k]!=i+1) return 0;
+		if (i==7 && mem!=before[i]) return 0;
+		if ((void*)mem>before[i]) return 0;
+		// an unlocked block is not left after a free run
+		const size_t addr=(uint64_t*)mem-heap;
+		if (i!=7 && addr>HEADER_UNITS && is_alloc_unit_free(addr-HEADER_UNITS-1)) return 0;
+		twr_hunlock(h[i]);
+	}
+	twr_hunlock(h[7]);
+	if (twr_heap_compact()==0) return 0;  // h[7] can now move
+
+	for (int i=0; i<20; i++)
+		twr_hfree(h[i]);
+	if (!validate_heap("handles freed")) return 0;
+
+	const size_t handle_table_units=heap[(uint64_t*)handle_table-heap-1]+HEADER_UNITS;
+	if (sz!=avail()+handle_table_units*ALLOC_SIZE) return 0;
+}
+
+{
+// memory pressure handlers are called, and the allocation retried, before malloc fails
+	const size_t sz=avail();
+	void* fill[64];
+	int num_fill=0;
+	large_object_threshold=(size_t)-1;  // so that the heap is filled with ordinary blocks
+
+	test_pressure_block=malloc(1000);
+	while (num_fill<64 && largest_free_run()>=1000+HEADER_UNITS*ALLOC_SIZE)
+		fill[num_fill++]=malloc(largest_free_run()-HEADER_UNITS*ALLOC_SIZE);
+	if (largest_free_run()>=1000+HEADER_UNITS*ALLOC_SIZE) return 0;
+
+	if (!twr_register_memory_pressure_handler(test_pressure_handler)) return 0;
+	test_pressure_calls=0;
+	void* mem=malloc(1000);  // only fits once the handler frees test_pressure_block
+	if (mem==NULL || test_pressure_calls!=1 || test_pressure_block!=NULL) return 0;
+
+	twr_unregister_memory_pressure_handler(test_pressure_handler);
+	for (int i=0; i<memory_pressure_handler_count; i++)
+		if (memory_pressure_handlers[i]==test_pressure_handler) return 0;
+
+	free(mem);
+	for (int i=0; i<num_fill; i++)
+		free(fill[i]);
+	large_object_threshold=LARGE_OBJECT_THRESHOLD;
+	if (avail()<sz) return 0;  // the twr_cache_malloc handler may have freed cached memory too
+	if (!validate_heap("memory pressure")) return 0;
+}
+
+{
+// heap profiling and stats
+	twr_heap_profile(true);
+	struct twr_heap_stats st0, st;
+	twr_heap_stats(&st0);
+	if (!st0.profiling || st0.free_bytes!=avail() || st0.heap_size!=heap_size_in_bytes) return 0;
+	if (st0.largest_free_run>st0.free_bytes || st0.fragmentation<0 || st0.fragmentation>1) return 0;
+
+	void* mem1=malloc(1);
+	void* mem2=malloc(100);
+	void* mem3=malloc(8);
+	twr_heap_stats(&st);
+	if (st.live_bytes!=st0.live_bytes+8+104+8 || st.peak_live_bytes!=st.live_bytes) return 0;
+	if (st.live_allocations!=st0.live_allocations+3 || st.total_allocations!=3) return 0;
+	if (st.live_by_size_class[0]!=st0.live_by_size_class[0]+2 || st.live_by_size_class[4]!=st0.live_by_size_class[4]+1) return 0;
+
+	mem2=realloc(mem2, 16);
+	free(mem1);
+	twr_heap_stats(&st);
+	if (st.live_bytes!=st0.live_bytes+16+8 || st.peak_live_bytes!=st0.live_bytes+8+104+8) return 0;
+	if (st.live_by_size_class[1]!=st0.live_by_size_class[1]+1 || st.live_by_size_class[4]!=st0.live_by_size_class[4]) return 0;
+	if (st.total_frees!=1 || st.live_allocations!=st0.live_allocations+2) return 0;
+
+	free(mem2);
+	free(mem3);
+	twr_heap_stats(&st);
+	if (st.live_bytes!=st0.live_bytes || st.live_allocations!=st0.live_allocations || st.free_bytes!=st0.free_bytes) return 0;
+
+	twr_heap_profile(false);
+	twr_heap_stats(&st);
+	if (st.profiling || st.live_bytes!=0) return 0;
+}
+
+#ifndef __wasm__
+{
+// add the rest of myheap to the heap, the same way heap_grow() adds memory from memory.grow
+	if (heap==myheap && mem_size_in_bytes==sizeof(myheap)/2) {
+		const size_t units=heap_size_in_alloc_units;
+		const size_t sz=avail();
+		unsigned char* mem1=malloc(100);
+		if (mem1==NULL) return 0;
+		for (int i=0; i<100; i++)
+			mem1[i]=i;
+
+		heap_extend(sizeof(myheap)/2);
+
+		if (heap_size_in_alloc_units<=units) return 0;
+		if (!validate_heap("heap extend")) return 0;
+		for (int i=0; i<100; i++)
+			if (mem1[i]!=i) return 0;
+		free(mem1);
+
+		if (avail()!=sz+(heap_size_in_alloc_units-units)*ALLOC_SIZE) return 0;
+
+		// only fits if the new units were coalesced with the free memory at the old end of the heap
+		if ((mem=malloc(avail()-units*ALLOC_SIZE/2))==NULL) return 0;
+		free(mem);
+		if (!validate_heap("heap extend complete")) return 0;
+	}
 }
+#endif
 	//twr_conlog("malloc unit test completed successfully");
 
 	return 1;
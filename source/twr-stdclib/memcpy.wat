@@ -10,6 +10,16 @@
     local.get $dest
     )
 
+;;void *memmove(void *dest, const void *src, size_t n);
+;;memory.copy copies as if through a temporary buffer, so it handles overlapping regions
+    (func $memmove (param $dest i32) (param $src i32) (param $n i32) (result i32)
+    local.get $dest
+    local.get $src
+    local.get $n
+    memory.copy
+    local.get $dest
+    )
+
 ;;void *memset(void *mem, int c, size_t n);
     (func $memset (param $mem i32) (param $val i32) (param $n i32) (result i32)
     local.get $mem
@@ -18,4 +28,12 @@
     memory.fill
     local.get $mem
     )
+
+;;void bzero (void *to, size_t count);
+    (func $bzero (param $to i32) (param $count i32)
+    local.get $to
+    i32.const 0
+    local.get $count
+    memory.fill
+    )
 )
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <limits.h>
 #include"twr-jsimports.h"
 
 #include "twr-crt.h"
@@ -11,12 +13,8 @@
 
 // de-featured printf
 
-static void outstr(twr_vcbprintf_callback out, void* cbdata, char *buffer, int size) {
-	while (*buffer && size >0) {
-		out(cbdata, *buffer);
-		buffer++;
-		size--;
-	}
+static void outstr(twr_vcbprintf_span_callback out, void* cbdata, const char *str) {
+	out(cbdata, str, strlen(str));
 }
 
 #define valid_flag(flag) (flag=='-' || flag==' ' || flag=='+' || flag=='#' || flag=='0')
@@ -96,7 +94,8 @@ void static do_width(const char* in, char* assembly, int size_assembly, bool pad
 	strcat_s(assembly, size_assembly, in);
 }
 
-void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format, va_list vlist) {
+// the formatted output is passed to 'out' in spans: runs of literal characters in the format string, and each formatted field
+void twr_vcbprintf_span(twr_vcbprintf_span_callback out, void* cbdata, const char *format, va_list vlist) {
 	struct pformat pf;
 
 	while (*format) {
@@ -124,7 +123,7 @@ void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format,
 					}
 
 					do_width(buffer, assembly+assemoff, sizeof(assembly)-assemoff, pf.flag_zero, pf.width);
-					outstr(out, cbdata, assembly, sizeof(assembly));
+					outstr(out, cbdata, assembly);
 				}
 					break;
 
@@ -134,7 +133,7 @@ void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format,
 					char assembly[16];
 					_itoa_s(va_arg(vlist, int), buffer, sizeof(buffer), 16);
 					do_width(buffer, assembly, sizeof(assembly), pf.flag_zero, pf.width);
-					outstr(out, cbdata, assembly, sizeof(assembly));
+					outstr(out, cbdata, assembly);
 
 				}
 					break;
@@ -156,7 +155,7 @@ void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format,
 					}
 
 					do_width(buffer, assembly+assemoff, sizeof(assembly)-assemoff, pf.flag_zero, pf.width);
-					outstr(out, cbdata, assembly, sizeof(assembly));
+					outstr(out, cbdata, assembly);
 				}
 					break;
 
@@ -177,7 +176,7 @@ void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format,
 					}
 
 					do_width(buffer, assembly+assemoff, sizeof(assembly)-assemoff, pf.flag_zero, pf.width);
-					outstr(out, cbdata, assembly, sizeof(assembly));
+					outstr(out, cbdata, assembly);
 				}
 					break;
 
@@ -198,33 +197,56 @@ void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format,
 						assemoff=0;
 					}
 					do_width(buffer, assembly+assemoff, sizeof(assembly)-assemoff, pf.flag_zero, pf.width);
-					outstr(out, cbdata, assembly, sizeof(assembly));
+					outstr(out, cbdata, assembly);
 				}
 					break;
 
 				case 's': 
-					outstr(out, cbdata, va_arg(vlist, char *), 100000);  // arbitrary max of 100K string length
+				{
+					const char* str=va_arg(vlist, char *);
+					out(cbdata, str, __min(strlen(str), 100000));  // arbitrary max of 100K string length
+				}
 					break;
 
 				case 'c': 
 				{
-					const int c=va_arg(vlist, int);
-					out(cbdata, c);
+					const char c=(char)va_arg(vlist, int);
+					out(cbdata, &c, 1);
 				}
 					break;
 
 				default:  // invalid format, just punt and print it
-					out(cbdata, *format);
-					format++;
+					if (*format) {
+						out(cbdata, format, 1);
+						format++;
+					}
 			}
 		}
 		else { // not a %
-			out(cbdata, *format);
-			format++;
+			const char* literal=format;
+			while (*format && *format!='%') format++;
+			out(cbdata, literal, format-literal);
 		}
 	}
 }
 
+struct vcbprintf_adapter_data {
+	twr_vcbprintf_callback out;
+	void* cbdata;
+};
+
+static void vcbprintf_adapter(void* datain, const char* str, size_t len) {
+	struct vcbprintf_adapter_data *const data=datain;
+	for (size_t i=0; i<len; i++)
+		data->out(data->cbdata, str[i]);
+}
+
+// same as twr_vcbprintf_span, but 'out' is called for each character
+void twr_vcbprintf(twr_vcbprintf_callback out, void* cbdata, const char *format, va_list vlist) {
+	struct vcbprintf_adapter_data data = {.out=out, .cbdata=cbdata};
+	twr_vcbprintf_span(vcbprintf_adapter, &data, format, vlist);
+}
+
 /*************/
 
 struct snprintf_callback_data {
@@ -233,12 +255,12 @@ struct snprintf_callback_data {
 	size_t pos;
 };
 
-static void snprintf_callback(void* datain, unsigned char ch) {
+static void snprintf_callback(void* datain, const char* str, size_t len) {
 	struct snprintf_callback_data *const data=datain;
 	if (data->pos+1 < data->bufsz) {  // leave room for terminating zero
-		data->buffer[data->pos]=(char)ch;
+		memcpy(data->buffer+data->pos, str, __min(len, data->bufsz-data->pos-1));
 	}
-	data->pos++;
+	data->pos+=len;
 }
 
 // if bufsz==0 the number of character that would have been written is counted, but nothing is written to buffer
@@ -246,7 +268,7 @@ static void snprintf_callback(void* datain, unsigned char ch) {
 int vsnprintf(char *buffer, size_t bufsz, const char *format, va_list vlist) {
 	assert(bufsz==0 || buffer);
 	struct snprintf_callback_data data = {.buffer=buffer, .bufsz=bufsz, .pos=0};
-	twr_vcbprintf(snprintf_callback, &data, format, vlist);
+	twr_vcbprintf_span(snprintf_callback, &data, format, vlist);
 	if (buffer && data.bufsz) buffer[__min(data.pos, bufsz-1)]=0; 
 	return data.pos;
 }
@@ -284,30 +306,52 @@ int vasprintf(char **strp, const char* format, va_list vlist ) {
 
 	int k=vsnprintf(NULL, 0, format, vlist);
 
-	void* buffer=malloc(k+1);
+	char* buffer=malloc(k+1);
+	if (buffer==NULL) {
+		va_end(args2);
+		*strp=NULL;
+		return -1;
+	}
 	vsnprintf(buffer, k+1, format, args2);
    va_end(args2);
+	*strp=buffer;
 
 	return k;
 }
 
 /*************/
 
+// output is collected in buf, so that io_write is called once per printf (or per sizeof(buf) bytes)
 struct putc_cbdata {
 	int count;
 	FILE* stream;
+	int len;
+	char buf[128];
 };
 
-static void putc_callback(void* datain, unsigned char ch) {
+static void putc_callback(void* datain, const char* str, size_t len) {
 	struct putc_cbdata *d=datain;
-	d->count++;
-	io_putc(d->stream, ch);
+	if (d->len+len > sizeof(d->buf)) {
+		io_write(d->stream, d->buf, d->len);
+		d->count+=d->len;
+		d->len=0;
+		if (len > sizeof(d->buf)) {
+			io_write(d->stream, str, len);
+			d->count+=len;
+			return;
+		}
+	}
+	memcpy(d->buf+d->len, str, len);
+	d->len+=len;
+}
+
+static int putc_done(struct putc_cbdata *d) {
+	if (d->len) io_write(d->stream, d->buf, d->len);
+	return d->count+d->len;
 }
 
 int vprintf(const char* format, va_list vlist ) {
-	struct putc_cbdata ud = {.stream=stdout, .count=0};
-	twr_vcbprintf(putc_callback, &ud, format, vlist);
-	return ud.count;
+	return vfprintf(stdout, format, vlist);
 }
 
 int printf(const char* format, ...) {
@@ -337,10 +381,10 @@ void twr_conlog(const char* format, ...) {
 
 // reurns the number of characters written if successful or negative value if an error occurred.
 int vfprintf( FILE *stream, const char *format, va_list vlist ) {
-	struct putc_cbdata ud = {.stream=stream, .count=0};
+	struct putc_cbdata ud = {.stream=stream, .count=0, .len=0};
 
-	twr_vcbprintf(putc_callback, &ud, format, vlist);
-	return ud.count;
+	twr_vcbprintf_span(putc_callback, &ud, format, vlist);
+	return putc_done(&ud);
 }
 
 int fprintf(FILE *stream, const char* format, ...) {
@@ -355,13 +399,7 @@ int fprintf(FILE *stream, const char* format, ...) {
 }
 
 size_t fwrite( const void* buffer, size_t size, size_t count, FILE* stream ) {
-	size_t k=size*count;
-	const unsigned char *p=buffer;
-
-	while (k--) {
-		io_putc(stream, *p++);
-	}
-
+	io_write(stream, buffer, size*count);
 	return count;
 }
 
@@ -373,16 +411,29 @@ int feof(FILE *stream) {
 	return 0;
 }
 
+// if stream is NULL, all streams are flushed
 int fflush(FILE *stream) {
+	if (stream==NULL) io_flush_all();
+	else io_flush(stream);
 	return 0;
 }
 
+int setvbuf(FILE* stream, char* buffer, int mode, size_t size) {
+	return io_setvbuf(stream, buffer, mode, size);
+}
+
+void setbuf(FILE* stream, char* buffer) {
+	if (buffer) setvbuf(stream, buffer, _IOFBF, BUFSIZ);
+	else setvbuf(stream, NULL, _IONBF, 0);
+}
+
 int is_terminal(FILE *stream) {
 	return 1;
 }
 
 int putc(int ch, FILE* stream) {
-	io_putc(stream, (unsigned char)ch);
+	const char c=(char)ch;
+	io_write(stream, &c, 1);
 	return ch;
 }
 
@@ -406,20 +457,244 @@ int fgetc(FILE *stream) {
 	return getc(stream);
 }
 
-// these three functions are not yet implemented
-// here to get libcxx to compile
+/*************/
+
+// sscanf, vsscanf
+// %[*][width][length]specifier
+// valid lengths: hh h l ll j z t L
+// valid specifiers: d i u o x X p n c s [ a e f g A E F G %
+// integers are parsed with __atoint_width() (also used by strtoll), and floating point with strtod_l()
+// hexadecimal floating point (like 0x1p3) is not supported
+
+static void store_int(void* dest, char length, uint64_t value) {
+	switch (length) {
+		case 'H': *(char*)dest=(char)value; break;    // hh
+		case 'h': *(short*)dest=(short)value; break;
+		case 'l': *(long*)dest=(long)value; break;
+		case 'q':  // ll
+		case 'L': *(long long*)dest=(long long)value; break;  // L is long double for floating point, and long long (as in glibc) for integers
+		case 'j': *(intmax_t*)dest=(intmax_t)value; break;
+		case 'z': *(size_t*)dest=(size_t)value; break;
+		case 't': *(ptrdiff_t*)dest=(ptrdiff_t)value; break;
+		default:  *(int*)dest=(int)value; break;
+	}
+}
+
+// applies the sign to the magnitude returned by __atoint_width, clamping out of range values the way strtoll and strtoull do
+static uint64_t signed_int_value(uint64_t value, int sign, bool overflow, bool is_signed) {
+	if (is_signed) {
+		if (sign>0 && value>(uint64_t)LLONG_MAX) return (uint64_t)LLONG_MAX;
+		if (sign<0 && value>(uint64_t)LLONG_MAX+1) return (uint64_t)LLONG_MIN;
+	}
+	else if (overflow) {
+		return UINT64_MAX;
+	}
+	return sign<0 ? 0-value : value;
+}
+
+// a %[ scanset, with one bit per character.  returns a pointer to the closing ], or NULL if there is none
+static const char* read_scanset(const char* format, unsigned char set[32]) {
+	bool invert=false;
+
+	if (*format=='^') {
+		invert=true;
+		format++;
+	}
+
+	memset(set, 0, 32);
+	const char* const first=format;
+	for (; *format && (*format!=']' || format==first); format++) {
+		unsigned char lo=*format, hi=lo;
+		if (format[1]=='-' && format[2] && format[2]!=']') {  // a range, like a-z
+			hi=format[2];
+			format+=2;
+		}
+		for (int c=lo; c<=hi; c++)
+			set[c>>3]|=1<<(c&7);
+	}
+	if (*format!=']') return NULL;
+
+	if (invert) {
+		for (int i=0; i<32; i++)
+			set[i]=~set[i];
+	}
+	set[0]&=~1;  // never matches the terminating zero
+	return format;
+}
+
+// returns the number of values assigned, or EOF if the input ends before the first conversion
 int vsscanf(const char *buffer, const char *format, va_list arglist) {
-	twr_conlog("vsscanf is not currently implemented.");
-	assert(false);
-	return EOF;
+	const locale_t loc=twr_get_current_locale();
+	const struct lconv* lcc=__get_lconv_lc_ctype(loc);
+	const bool ascii_space=__is_c_locale(lcc) || __is_utf8_locale(lcc);  // so %s doesn't need isspace_l() for each character
+	const char* in=buffer;
+	int assigned=0;
+	bool converted=false;
+
+	while (*format) {
+		const unsigned char f=*format;
+
+		if (f==' ' || (f>='\t' && f<='\r')) {  // white space in the format matches any amount of white space
+			in=__skipspace_l(in, loc);
+			format++;
+			continue;
+		}
+
+		if (f!='%' || format[1]=='%') {  // a literal character
+			if (f=='%') {
+				in=__skipspace_l(in, loc);
+				format++;
+			}
+			if (*in==0) goto input_failure;
+			if (*in!=*format) break;
+			in++;
+			format++;
+			continue;
+		}
+
+		format++;
+		const bool suppress = *format=='*';
+		if (suppress) format++;
+
+		int width=0;
+		while (*format>='0' && *format<='9')
+			width=width*10+(*format++ - '0');
+		const bool has_width = width>0;
+		if (!has_width) width=INT_MAX;
+
+		char length=0;
+		if (format[0]=='h' && format[1]=='h') { length='H'; format+=2; }
+		else if (format[0]=='l' && format[1]=='l') { length='q'; format+=2; }
+		else if (*format=='h' || *format=='l' || *format=='j' || *format=='z' || *format=='t' || *format=='L') length=*format++;
+
+		const char spec=*format++;
+
+		if (spec=='n') {
+			if (!suppress) store_int(va_arg(arglist, void*), length, in-buffer);
+			continue;
+		}
+
+		// all conversions except %c and %[ skip white space
+		if (spec!='c' && spec!='[') in=__skipspace_l(in, loc);
+		if (*in==0) goto input_failure;
+
+		switch (spec) {
+			case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'p':
+			{
+				const int base = spec=='i' ? 0 : spec=='o' ? 8 : (spec=='d' || spec=='u') ? 10 : 16;
+				char* end;
+				int sign;
+				bool overflow;
+				const uint64_t value=__atoint_width(in, &end, base, width, &sign, &overflow);
+				if (end==in) goto matching_failure;
+				in=end;
+				if (!suppress) {
+					if (spec=='p') *va_arg(arglist, void**)=(void*)(uintptr_t)value;
+					else store_int(va_arg(arglist, void*), length, signed_int_value(value, sign, overflow, spec=='d' || spec=='i'));
+				}
+			}
+				break;
+
+			case 'a': case 'e': case 'f': case 'g': case 'A': case 'E': case 'F': case 'G':
+			{
+				char* end;
+				double value=strtod_l(in, &end, loc);
+				if (end==in) goto matching_failure;
+				if (end-in > width) {  // the field width ends the number early, so parse just that part of it
+					char small[64];
+					char* const copy = width<(int)sizeof(small) ? small : malloc(width+1);
+					if (copy==NULL) goto matching_failure;
+					memcpy(copy, in, width);
+					copy[width]=0;
+					value=strtod_l(copy, &end, loc);
+					const bool valid = end!=copy;
+					end=(char*)in+(end-copy);
+					if (copy!=small) free(copy);
+					if (!valid) goto matching_failure;
+				}
+				in=end;
+				if (!suppress) {
+					if (length=='l') *va_arg(arglist, double*)=value;
+					else if (length=='L') *va_arg(arglist, long double*)=value;
+					else *va_arg(arglist, float*)=(float)value;
+				}
+			}
+				break;
+
+			case 's':
+			{
+				const char* const start=in;
+				while (*in && width>0 && !(ascii_space ? (*in==' ' || (*in>='\t' && *in<='\r')) : isspace_l((unsigned char)*in, loc))) {
+					in++;
+					width--;
+				}
+				if (!suppress) {
+					char* dest=va_arg(arglist, char*);
+					memcpy(dest, start, in-start);
+					dest[in-start]=0;
+				}
+			}
+				break;
+
+			case 'c':
+			{
+				if (!has_width) width=1;
+				for (int i=0; i<width; i++)
+					if (in[i]==0) goto input_failure;
+				if (!suppress) memcpy(va_arg(arglist, char*), in, width);
+				in+=width;
+			}
+				break;
+
+			case '[':
+			{
+				unsigned char set[32];
+				format=read_scanset(format, set);
+				if (format==NULL) return converted ? assigned : EOF;  // invalid format
+				format++;
+
+				const char* const start=in;
+				while (width>0 && (set[(unsigned char)*in>>3]&(1<<(*in&7)))) {
+					in++;
+					width--;
+				}
+				if (in==start) goto matching_failure;
+				if (!suppress) {
+					char* dest=va_arg(arglist, char*);
+					memcpy(dest, start, in-start);
+					dest[in-start]=0;
+				}
+			}
+				break;
+
+			default:  // invalid format
+				goto matching_failure;
+		}
+
+		converted=true;
+		if (!suppress) assigned++;
+	}
+
+matching_failure:
+	return assigned;
+
+input_failure:
+	return converted ? assigned : EOF;
 }
 
 int sscanf( const char *buffer, const char *format, ... ) {
-	twr_conlog("sscanf is not currently implemented.");
-	assert(false);
-	return EOF;
+	va_list vlist;
+	va_start(vlist, format);
+
+	const int rv=vsscanf(buffer, format, vlist);
+
+	va_end(vlist);
+
+	return rv;
 }
 
+// this function is not yet implemented
+// here to get libcxx to compile
 int ungetc( int ch, FILE *stream ) {
 	twr_conlog("ungetc is not currently implemented.");
 	assert(false);
@@ -431,20 +706,156 @@ int ungetc( int ch, FILE *stream ) {
 
 // this function is used by clang printf builtin
 int puts(const char *str) {
-	io_putstr(stdout, str);
-	io_putc(stdout,'\n');
+	io_write(stdout, str, strlen(str));
+	io_write(stdout, "\n", 1);
 	return 1;
 }
 
 // this function is used by clang printf builtin
 int putchar(int c) {
-	io_putc(stdout, (char)c);
-	return c;
+	return putc(c, stdout);
 }
 
 /*************/
 
 
+static char bufcon_out[32];
+static int bufcon_code_page;  // the code page in effect when io_putstr was last called
+
+static void bufcon_putc(twr_ioconsole_t* io, unsigned char c) {
+	const size_t len=strlen(bufcon_out);
+	bufcon_out[len]=c ? c : '@';
+	bufcon_out[len+1]=0;
+}
+
+static void bufcon_putstr(twr_ioconsole_t* io, const char* str) {
+	strcat(bufcon_out, str);
+	strcat(bufcon_out, "|");  // marks each io_putstr call
+	bufcon_code_page=__get_current_lc_ctype_code_page_modified();
+}
+
+static int buffering_test(void) {
+	static twr_ioconsole_t con;
+	con.header.type=IO_TYPE_CHARWRITE;
+	con.charout.io_putc=bufcon_putc;
+	con.charout.io_putstr=bufcon_putstr;
+
+	bufcon_out[0]=0;
+	fprintf(&con, "ab%d\n", 1);  // output only consoles are fully buffered
+	if (bufcon_out[0]!=0) return 0;
+	fflush(&con);
+	if (strcmp(bufcon_out, "ab1\n|")!=0) return 0;
+
+	bufcon_out[0]=0;
+	if (setvbuf(&con, NULL, _IOLBF, 0)!=0) return 0;
+	fputc('a', &con);
+	fwrite("b\0c\nd", 1, 5, &con);
+	if (strcmp(bufcon_out, "ab|@c\nd|")!=0) return 0;
+
+	bufcon_out[0]=0;
+	char small[4];
+	setvbuf(&con, small, _IOFBF, sizeof(small));
+	fprintf(&con, "12345");
+	io_putc(&con, '!');  // direct console output sends buffered output first
+	if (strcmp(bufcon_out, "123|45|!")!=0) return 0;
+
+	bufcon_out[0]=0;
+	setvbuf(&con, NULL, _IONBF, 0);
+	fprintf(&con, "%s%d", "x", 2);
+	if (strcmp(bufcon_out, "x2|")!=0) return 0;
+
+	if (setvbuf(&con, NULL, 99, 0)==0) return 0;
+
+	// buffered output is sent with the code page that was in effect when it was written, even when setlocale changes the current locale in place
+	setvbuf(&con, NULL, _IOFBF, 0);
+	setlocale(LC_ALL, ".1252");
+	bufcon_out[0]=0;
+	fprintf(&con, "a");
+	setlocale(LC_ALL, "C");
+	if (strcmp(bufcon_out, "a|")!=0 || bufcon_code_page!=TWR_CODEPAGE_1252) return 0;
+	bufcon_out[0]=0;
+	fprintf(&con, "b");
+	setlocale(LC_CTYPE, ".1252");
+	if (strcmp(bufcon_out, "b|")!=0 || bufcon_code_page!=TWR_CODEPAGE_UTF8) return 0;
+	setlocale(LC_ALL, "C");
+
+	io_close(&con);
+
+	return 1;
+}
+
+static int sscanf_test(void) {
+	int i, j, n;
+	unsigned u;
+	long l;
+	long long ll;
+	short h;
+	signed char hh;
+	float f;
+	double d;
+	void* ptr;
+	char s[32], s2[32];
+
+	if (sscanf("  42 -17", "%d%d", &i, &j)!=2 || i!=42 || j!=-17) return 0;
+	if (sscanf("0x1F 010 12", "%i %i %i", &i, &j, &n)!=3 || i!=31 || j!=8 || n!=12) return 0;
+	if (sscanf("ff 777 4294967295", "%x %o %u", &i, &j, &u)!=3 || i!=255 || j!=511 || u!=4294967295U) return 0;
+	if (sscanf("0x1234", "%p", &ptr)!=1 || ptr!=(void*)0x1234) return 0;
+	if (sscanf("-9223372036854775808 123456 -2 300", "%lld %ld %hhd %hd", &ll, &l, &hh, &h)!=4) return 0;
+	if (ll!=(-9223372036854775807LL-1) || l!=123456 || hh!=-2 || h!=300) return 0;
+	if (sscanf("18446744073709551617", "%lld", &ll)!=1 || ll!=9223372036854775807LL) return 0;  // out of range values are clamped
+	if (sscanf("-9223372036854775809", "%lld", &ll)!=1 || ll!=(-9223372036854775807LL-1)) return 0;
+	if (sscanf("18446744073709551617", "%llu", &ll)!=1 || (unsigned long long)ll!=18446744073709551615ULL) return 0;
+	if (sscanf("-1", "%llx", &ll)!=1 || ll!=-1) return 0;
+	if (sscanf("4294967296", "%Ld", &ll)!=1 || ll!=4294967296LL) return 0;
+
+	// field widths
+	if (sscanf("12345", "%2d%3d", &i, &j)!=2 || i!=12 || j!=345) return 0;
+	if (sscanf("3.14159", "%4f%lf", &f, &d)!=2 || f!=3.14f || d!=159) return 0;
+	if (sscanf("1e5", "%2lf", &d)!=1 || d!=1) return 0;
+	if (sscanf("abcdef", "%3s%s", s, s2)!=2 || strcmp(s, "abc")!=0 || strcmp(s2, "def")!=0) return 0;
+
+	// floating point
+	if (sscanf(" -1.5e3 0.1 inf", "%f %lf %lf", &f, &d, &d)!=3 || f!=-1500 || d!=twr_infval()) return 0;
+	if (sscanf("0.1", "%lf", &d)!=1 || d!=0.1) return 0;
+	if (sscanf("infinity7", "%lf%d", &d, &i)!=2 || d!=twr_infval() || i!=7) return 0;
+
+	// %c %s %[ %n %% and suppression
+	if (sscanf("x yz", "%c %2c", s, s2)!=2 || s[0]!='x' || s2[0]!='y' || s2[1]!='z') return 0;
+	if (sscanf("  word\tnext", "%s%n", s, &n)!=1 || strcmp(s, "word")!=0 || n!=6) return 0;
+	if (sscanf("key=value;rest", "%[^=]=%[a-z]", s, s2)!=2 || strcmp(s, "key")!=0 || strcmp(s2, "value")!=0) return 0;
+	if (sscanf("]]x", "%[]]", s)!=1 || strcmp(s, "]]")!=0) return 0;
+	if (sscanf("100% 7", "%d%% %d", &i, &j)!=2 || i!=100 || j!=7) return 0;
+	if (sscanf("1 2 3", "%*d %d %n%d", &i, &n, &j)!=2 || i!=2 || n!=4 || j!=3) return 0;
+
+	// matching and input failures
+	i=-1;
+	if (sscanf("abc", "%d", &i)!=0 || i!=-1) return 0;
+	if (sscanf("5 abc", "%d %d", &i, &j)!=1 || i!=5) return 0;
+	if (sscanf("5,6", "%d;%d", &i, &j)!=1) return 0;
+	if (sscanf("", "%d", &i)!=EOF) return 0;
+	if (sscanf("   ", "%s", s)!=EOF) return 0;
+	if (sscanf("5", "%d %d", &i, &j)!=1) return 0;
+	if (sscanf("ab", "%3c", s)!=EOF) return 0;  // the input ends inside the field (glibc returns 1)
+
+	return 1;
+}
+
+static void vcbprintf_test_callback(void* cbdata, unsigned char c) {
+	char** p=cbdata;
+	*(*p)++=c;
+}
+
+// twr_vcbprintf (single character callback)
+static int vcbprintf_test(char* b, const char* format, ...) {
+	va_list vlist;
+	va_start(vlist, format);
+	char* p=b;
+	twr_vcbprintf(vcbprintf_test_callback, &p, format, vlist);
+	*p=0;
+	va_end(vlist);
+	return 1;
+}
+
 int printf_unit_test() {
 	char b[100];
 	int k;
@@ -616,6 +1027,24 @@ int printf_unit_test() {
 	sprintf(b, "%02d",4);
 	if (strcmp(b, "04")!=0) return 0;
 
+// spans
+	k=snprintf(b, 8, "abc%sdef%d", "XYZ", 12);
+	if (k!=11 || strcmp(b, "abcXYZd")!=0) return 0;
+
+	k=snprintf(b, 4, "%d", 123456);
+	if (k!=6 || strcmp(b, "123")!=0) return 0;
+
+	k=snprintf(NULL, 0, "log: [%s] %d", "info", 42);
+	if (k!=14) return 0;
+
+	k=snprintf(b, sizeof(b), "a%cb", 0);
+	if (k!=3 || b[0]!='a' || b[1]!=0 || b[2]!='b') return 0;
+
+	if (!vcbprintf_test(b, "x=%d %s", 5, "end") || strcmp(b, "x=5 end")!=0) return 0;
+
+	if (!buffering_test()) return 0;
+	if (!sscanf_test()) return 0;
+
 // UTF-8 Support with "C" locale (current default)
 	char* locstr=setlocale(LC_CTYPE, NULL);
 	strcpy(b, "\u20AC1.23");
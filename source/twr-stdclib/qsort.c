@@ -0,0 +1,265 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "twr-crt.h"
+
+/* qsort() is an introsort: quicksort with a median of three pivot, that switches to heapsort if the recursion gets */
+/* deeper than 2*log2(n) (so the worst case is O(n log n)), and to insertion sort for partitions of 16 or fewer elements. */
+/* Swaps of 4, 8, and 16 byte elements are done with integer loads and stores. */
+
+#define INSERTION_SORT_CUTOFF 16
+
+typedef int (*compar_r_t)(const void *, const void *, void *);
+
+static inline void swap(unsigned char* a, unsigned char* b, size_t size) {
+	switch (size) {
+		case 4: {
+			uint32_t t;
+			memcpy(&t, a, 4);
+			memcpy(a, b, 4);
+			memcpy(b, &t, 4);
+			return;
+		}
+		case 8: {
+			uint64_t t;
+			memcpy(&t, a, 8);
+			memcpy(a, b, 8);
+			memcpy(b, &t, 8);
+			return;
+		}
+		case 16: {
+			uint64_t t[2];
+			memcpy(t, a, 16);
+			memcpy(a, b, 16);
+			memcpy(b, t, 16);
+			return;
+		}
+		default: {
+			uint64_t t;
+			for (; size>=8; size-=8, a+=8, b+=8) {
+				memcpy(&t, a, 8);
+				memcpy(a, b, 8);
+				memcpy(b, &t, 8);
+			}
+			for (; size>0; size--, a++, b++) {
+				const unsigned char c=*a;
+				*a=*b;
+				*b=c;
+			}
+		}
+	}
+}
+
+static void insertion_sort(unsigned char* base, size_t n, size_t size, compar_r_t compar, void* arg) {
+	for (size_t i=1; i<n; i++)
+		for (unsigned char* p=base+i*size; p>base && compar(p-size, p, arg)>0; p-=size)
+			swap(p-size, p, size);
+}
+
+static void sift_down(unsigned char* base, size_t root, size_t n, size_t size, compar_r_t compar, void* arg) {
+	while (1) {
+		size_t child=2*root+1;
+		if (child>=n) return;
+		if (child+1<n && compar(base+child*size, base+(child+1)*size, arg)<0)
+			child++;
+		if (compar(base+root*size, base+child*size, arg)>=0) return;
+		swap(base+root*size, base+child*size, size);
+		root=child;
+	}
+}
+
+static void heap_sort(unsigned char* base, size_t n, size_t size, compar_r_t compar, void* arg) {
+	for (size_t i=n/2; i>0; i--)
+		sift_down(base, i-1, n, size, compar, arg);
+	for (size_t end=n-1; end>0; end--) {
+		swap(base, base+end*size, size);
+		sift_down(base, 0, end, size, compar, arg);
+	}
+}
+
+static void intro_sort(unsigned char* base, size_t n, size_t size, compar_r_t compar, void* arg, int depth) {
+	while (n>INSERTION_SORT_CUTOFF) {
+		if (depth==0) {
+			heap_sort(base, n, size, compar, arg);
+			return;
+		}
+		depth--;
+
+		// put the median of the first, middle, and last elements at base[0], to use as the pivot
+		unsigned char* first=base;
+		unsigned char* mid=base+(n/2)*size;
+		unsigned char* last=base+(n-1)*size;
+		if (compar(mid, first, arg)<0) swap(mid, first, size);
+		if (compar(last, mid, arg)<0) {
+			swap(last, mid, size);
+			if (compar(mid, first, arg)<0) swap(mid, first, size);
+		}
+		swap(first, mid, size);
+
+		// partition so that [0,j) <= pivot <= (j,n).  Stopping on elements equal to the pivot keeps partitions
+		// balanced when there are many duplicates
+		size_t i=0, j=n;
+		while (1) {
+			while (compar(base+(++i)*size, base, arg)<0)
+				if (i==n-1) break;
+			while (compar(base, base+(--j)*size, arg)<0)
+				if (j==0) break;
+			if (i>=j) break;
+			swap(base+i*size, base+j*size, size);
+		}
+		swap(base, base+j*size, size);
+
+		// recurse into the smaller side, and loop on the larger, so the stack depth is at most log2(n)
+		const size_t left=j, right=n-j-1;
+		if (left<right) {
+			intro_sort(base, left, size, compar, arg, depth);
+			base+=(j+1)*size;
+			n=right;
+		}
+		else {
+			intro_sort(base+(j+1)*size, right, size, compar, arg, depth);
+			n=left;
+		}
+	}
+
+	insertion_sort(base, n, size, compar, arg);
+}
+
+void qsort_r(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *, void *), void *arg) {
+	if (nmemb<2 || size==0) return;
+
+	int depth=0;
+	for (size_t n=nmemb; n>1; n>>=1)
+		depth+=2;
+
+	intro_sort(base, nmemb, size, compar, arg, depth);
+}
+
+struct qsort_compar {
+	int (*compar)(const void *, const void *);
+};
+
+static int qsort_compar_adapter(const void* a, const void* b, void* arg) {
+	return ((struct qsort_compar*)arg)->compar(a, b);
+}
+
+void qsort(void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *)) {
+	struct qsort_compar c={compar};
+	qsort_r(base, nmemb, size, qsort_compar_adapter, &c);
+}
+
+void *bsearch(const void *key, const void *base, size_t nmemb, size_t size, int (*compar)(const void *, const void *)) {
+	const unsigned char* lo=base;
+
+	while (nmemb>0) {
+		const unsigned char* mid=lo+(nmemb/2)*size;
+		const int r=compar(key, mid);
+		if (r==0) return (void*)mid;
+		if (r>0) {
+			lo=mid+size;
+			nmemb-=nmemb/2+1;
+		}
+		else {
+			nmemb/=2;
+		}
+	}
+
+	return NULL;
+}
+
+/************************************************/
+
+static int compare_int(const void* a, const void* b) {
+	const int x=*(const int*)a, y=*(const int*)b;
+	return x<y ? -1 : x>y;
+}
+
+static int compare_int64_r(const void* a, const void* b, void* descending) {
+	int64_t x, y;
+	memcpy(&x, a, 8);
+	memcpy(&y, b, 8);
+	if (*(bool*)descending) return x<y ? 1 : -(x>y);
+	return x<y ? -1 : x>y;
+}
+
+// elements of 16 and 12 bytes, that sort by key, and keep a payload to check that whole elements were moved
+struct elem16 { int32_t key; int32_t payload[3]; };
+struct elem12 { int32_t key; int32_t payload[2]; };
+
+static int compare_elem16(const void* a, const void* b) {
+	return compare_int(&((const struct elem16*)a)->key, &((const struct elem16*)b)->key);
+}
+
+static int compare_elem12(const void* a, const void* b) {
+	return compare_int(&((const struct elem12*)a)->key, &((const struct elem12*)b)->key);
+}
+
+static int compare_char(const void* a, const void* b) {
+	return *(const unsigned char*)a-*(const unsigned char*)b;
+}
+
+int qsort_unit_test(void) {
+	enum {N=2000};
+	static int a[N];
+	static int64_t b[N];
+	static struct elem16 c[N];
+	static struct elem12 d[N];
+	static unsigned char e[N];
+
+	// random, sorted, reverse sorted, all equal, few values, and "organ pipe" inputs, of several lengths
+	for (int pattern=0; pattern<6; pattern++) {
+		for (int n=0; n<=N; n=(n<40 ? n+1 : n*3)) {
+			uint32_t seed=pattern+1;
+			int64_t sum=0;
+			for (int i=0; i<n; i++) {
+				seed=seed*1103515245+12345;
+				int v;
+				switch (pattern) {
+					case 0: v=(int)(seed>>4)-(1<<27); break;
+					case 1: v=i; break;
+					case 2: v=n-i; break;
+					case 3: v=7; break;
+					case 4: v=(seed>>16)%4; break;
+					default: v=i<n/2 ? i : n-i; break;
+				}
+				a[i]=v;
+				b[i]=(int64_t)v*1000000007;
+				c[i].key=v; c[i].payload[0]=v+1; c[i].payload[1]=v+2; c[i].payload[2]=v+3;
+				d[i].key=v; d[i].payload[0]=-v; d[i].payload[1]=v^0x5555;
+				e[i]=(unsigned char)v;
+				sum+=v;
+			}
+
+			qsort(a, n, sizeof(int), compare_int);
+			bool descending=true;
+			qsort_r(b, n, sizeof(int64_t), compare_int64_r, &descending);
+			qsort(c, n, sizeof(struct elem16), compare_elem16);
+			qsort(d, n, sizeof(struct elem12), compare_elem12);
+			qsort(e, n, 1, compare_char);
+
+			int64_t sorted_sum=0;
+			for (int i=0; i<n; i++) {
+				sorted_sum+=a[i];
+				if (i>0 && (a[i-1]>a[i] || b[i-1]<b[i] || c[i-1].key>c[i].key || d[i-1].key>d[i].key || e[i-1]>e[i])) return 0;
+				if (b[n-1-i]!=(int64_t)a[i]*1000000007) return 0;
+				if (c[i].key!=a[i] || c[i].payload[0]!=a[i]+1 || c[i].payload[2]!=a[i]+3) return 0;
+				if (d[i].key!=a[i] || d[i].payload[0]!=-a[i] || d[i].payload[1]!=(a[i]^0x5555)) return 0;
+			}
+			if (sorted_sum!=sum) return 0;
+		}
+	}
+
+	// bsearch finds every element, and doesn't find values between them
+	for (int i=0; i<N; i++)
+		a[i]=i*2;
+	for (int i=0; i<N; i++) {
+		const int key=i*2, missing=i*2+1;
+		if (bsearch(&key, a, N, sizeof(int), compare_int)!=&a[i]) return 0;
+		if (bsearch(&missing, a, N, sizeof(int), compare_int)!=NULL) return 0;
+	}
+	const int minus_one=-1;
+	if (bsearch(&minus_one, a, N, sizeof(int), compare_int)!=NULL) return 0;
+	if (bsearch(&minus_one, a, 0, sizeof(int), compare_int)!=NULL) return 0;
+
+	return 1;
+}
@@ -6,6 +6,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <twr-jsimports.h>
+#include "twr-crt.h"
 #include <stdio.h>
 
 // "C", "", and ".1252" locales supported
@@ -311,6 +312,10 @@ locale_t newlocale(int category_mask, const char *locale, locale_t base) {
 		return (locale_t)0;
 	}
 
+	// base is changed in place, so if it is the current locale, buffered output must be sent while its code page is still in effect
+	if (base==twr_get_current_locale())
+		io_flush_all();
+
 	if (base==NULL || base==__get_static_locale_c()) {
 		base=(locale_t)calloc(1, sizeof(struct __locale_t_struct));
 		base->lc_all=&lconv_C;
@@ -351,7 +356,10 @@ locale_t newlocale(int category_mask, const char *locale, locale_t base) {
 
 locale_t	uselocale(locale_t loc) {
 	locale_t old = twr_get_current_locale();
-	if (loc) __set_current_locale(loc);
+	if (loc) {
+		io_flush_all();  // buffered output is sent using the code page of the current locale
+		__set_current_locale(loc);
+	}
 	return old;
 }
 
@@ -445,24 +453,40 @@ int twr_code_page_to_utf32_streamed(unsigned char byte) {
 	return r;
 }
 
+static void free_dtnames(void) {
+	for (int i=0;i<7;i++) {
+		free((void*)dtnames->day[i]);
+		free((void*)dtnames->abday[i]);
+	}
+	for (int i=0;i<12;i++) {
+		free((void*)dtnames->month[i]);
+		free((void*)dtnames->abmonth[i]);
+	}
+	free((void*)dtnames->ampm[0]);
+	free((void*)dtnames->ampm[1]);
+	free(dtnames);
+	dtnames=0;
+}
+
+// when malloc runs out of memory, the date and time names are freed.  __get_dtnames fetches them again when next needed.
+static size_t dtnames_memory_pressure(size_t size) {
+	if (dtnames==0) return 0;
+	const size_t before=avail();
+	free_dtnames();
+	return avail()-before;
+}
+
 struct locale_dtnames* __get_dtnames(locale_t loc) {
 	const int cp = __get_code_page(__get_lconv_lc_time(loc));
 	if (dtnames==0) {
+		static bool registered;
+		if (!registered)
+			registered=twr_register_memory_pressure_handler(dtnames_memory_pressure);
 		dtnames=twrGetDtnames(cp);
 		dtcp=cp;
 	}
 	else if (cp!=dtcp) {
-		for (int i=0;i<7;i++) {
-			free((void*)dtnames->day[i]);
-			free((void*)dtnames->abday[i]);
-		}
-		for (int i=0;i<12;i++) {
-			free((void*)dtnames->month[i]);
-			free((void*)dtnames->abmonth[i]);
-		}
-		free((void*)dtnames->ampm[0]);
-		free((void*)dtnames->ampm[1]);
-		free(dtnames);
+		free_dtnames();
 		dtnames=twrGetDtnames(cp);
 		dtcp=cp;
 	}
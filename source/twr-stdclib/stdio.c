@@ -1,4 +1,5 @@
 #include <stddef.h>
+#include <stdio.h>
 #include "twr-crt.h"
 
 static twr_ioconsole_t *__stdio, *__dbgout;
@@ -9,6 +10,9 @@ void twr_set_stdio_con(twr_ioconsole_t *setto) {
 
 void twr_set_stderr_con(twr_ioconsole_t *setto) {
 	__dbgout=setto; 
+	// stderr is line buffered, even when its console is output only (eg. the browser debug console)
+	if (setto && setto->outbuf.mode==0)
+		setto->outbuf.mode=_IOLBF;
 }
 
 twr_ioconsole_t * twr_get_stdio_con() {
@@ -8,6 +8,54 @@
 
 /* these are all ASCII (not locale specific) implementations */
 
+/* when compiled with -msimd128, strlen, strchr, memchr, memcmp, strcmp, and strncmp process 16 bytes per iteration. */
+/* Loads that may read past the end of a string are either 16 byte aligned, or checked not to cross a 4KB boundary. */
+/* Either way they can't cross the end of memory (which is a multiple of 64KB), so the extra bytes read are harmless. */
+
+#ifdef __wasm_simd128__
+typedef unsigned char __u8x16 __attribute__((vector_size(16), aligned(16), __may_alias__));
+typedef signed char __i8x16 __attribute__((vector_size(16), aligned(16)));
+struct __u8x16_unaligned { __u8x16 v; } __attribute__((packed, __may_alias__));
+
+static inline __u8x16 load16(const void* p) {
+	return *(const __u8x16*)p;
+}
+
+static inline __u8x16 loadu16(const void* p) {
+	return ((const struct __u8x16_unaligned*)p)->v;
+}
+
+static inline __u8x16 splat16(unsigned char c) {
+	const __u8x16 zero={0};
+	return zero+c;
+}
+
+// bit n is set if byte n of a and b are equal
+static inline uint32_t eq_mask(__u8x16 a, __u8x16 b) {
+	return (uint32_t)__builtin_wasm_bitmask_i8x16((__i8x16)(a==b));
+}
+
+#define LOAD16_WITHIN_PAGE(p) ((((uintptr_t)(p))&4095)<=4096-16)
+#endif
+
+#ifdef __wasm_simd128__
+size_t strlen(const char * str) {
+	if (str==NULL) return 0;
+
+	const uintptr_t misalign=(uintptr_t)str&15;
+	const unsigned char* p=(const unsigned char*)str-misalign;
+	const __u8x16 zero=splat16(0);
+
+	uint32_t mask=eq_mask(load16(p), zero)>>misalign;
+	if (mask) return __builtin_ctz(mask);
+
+	while (1) {
+		p+=16;
+		mask=eq_mask(load16(p), zero);
+		if (mask) return p+__builtin_ctz(mask)-(const unsigned char*)str;
+	}
+}
+#else
 size_t strlen(const char * str) {
 
 	size_t k=0;
@@ -19,6 +67,7 @@ size_t strlen(const char * str) {
 
 	return k;
 }
+#endif
 
 int twr_utf8_char_len(const char *str) {
 	const unsigned char* mbstr=(const unsigned char*)str;
@@ -43,22 +92,336 @@ int twr_utf8_char_len(const char *str) {
 size_t twr_mbslen_l(const char *str, locale_t locale) {
 	const struct lconv* lcc = __get_lconv_lc_ctype(locale);
 	if (__is_utf8_locale(lcc)) {
-		size_t k=0, len=0;
-
 		if (str==NULL) return 0;
+		return twr_utf8_count(str, strlen(str));
+	}
+	else {
+		return strlen(str);
+	}
+}
 
-		while (str[k])  {
-			len++;
-			k=k+twr_utf8_char_len(str+k);
-		}
+/****************************************************************/
 
-		return len;
+/* Bulk UTF-8 routines.  These take a byte count (rather than stopping at a 0), and never assert on malformed input. */
+/* ASCII is checked and converted 16 bytes at a time with -msimd128, otherwise 8 bytes at a time. */
+
+// decodes the UTF-8 sequence at str, which has len>0 bytes available.
+// returns the length of the sequence, or 0 if it is not valid (overlong, a surrogate, above 0x10FFFF, or truncated)
+static int utf8_decode(const unsigned char* str, size_t len, int* code_point) {
+	const unsigned char c=str[0];
+	int n, min;
+	uint32_t v;
+
+	if (c<0x80) {
+		*code_point=c;
+		return 1;
+	}
+	else if ((c&0xE0)==0xC0) {
+		n=2; v=c&0x1F; min=0x80;
+	}
+	else if ((c&0xF0)==0xE0) {
+		n=3; v=c&0x0F; min=0x800;
+	}
+	else if (c>=0xF0 && c<=0xF4) {
+		n=4; v=c&0x07; min=0x10000;
 	}
 	else {
-		return strlen(str);
+		return 0;
 	}
+
+	if ((size_t)n>len) return 0;
+	for (int i=1; i<n; i++) {
+		if ((str[i]&0xC0)!=0x80) return 0;
+		v=(v<<6)|(str[i]&0x3F);
+	}
+	if (v<(uint32_t)min || v>0x10FFFF || (v>=0xD800 && v<=0xDFFF)) return 0;
+
+	*code_point=v;
+	return n;
 }
 
+// code points that are not valid (surrogates, negative, or above 0x10FFFF) are encoded as U+FFFD
+static int utf8_encode(int code_point, unsigned char* out) {
+	uint32_t c=code_point;
+	if (c>0x10FFFF || (c>=0xD800 && c<=0xDFFF)) c=0xFFFD;
+
+	if (c<0x80) {
+		out[0]=c;
+		return 1;
+	}
+	else if (c<0x800) {
+		out[0]=0xC0|(c>>6);
+		out[1]=0x80|(c&0x3F);
+		return 2;
+	}
+	else if (c<0x10000) {
+		out[0]=0xE0|(c>>12);
+		out[1]=0x80|((c>>6)&0x3F);
+		out[2]=0x80|(c&0x3F);
+		return 3;
+	}
+	else {
+		out[0]=0xF0|(c>>18);
+		out[1]=0x80|((c>>12)&0x3F);
+		out[2]=0x80|((c>>6)&0x3F);
+		out[3]=0x80|(c&0x3F);
+		return 4;
+	}
+}
+
+#ifdef __wasm_simd128__
+typedef int __i32x4 __attribute__((vector_size(16), aligned(16), __may_alias__));
+typedef unsigned char __u8x4 __attribute__((vector_size(4)));
+struct __i32x4_unaligned { __i32x4 v; } __attribute__((packed, __may_alias__));
+
+// true if all 16 bytes are ASCII
+static inline bool is_ascii16(__u8x16 v) {
+	return __builtin_wasm_bitmask_i8x16((__i8x16)v)==0;
+}
+
+static inline __u8x16 lookup16(__u8x16 table, __u8x16 index) {
+	return (__u8x16)__builtin_wasm_swizzle_i8x16((__i8x16)table, (__i8x16)index);
+}
+
+// The lookup table validator from "Validating UTF-8 In Less Than One Instruction Per Byte" (Keiser and Lemire).
+// Each byte is classified by its high nibble, and by the high and low nibble of the byte before it.  A bit that is
+// set in all three classifications is an error, except that a continuation byte may follow a continuation byte
+// if it is the third or fourth byte of a sequence.
+#define TOO_SHORT       (1<<0)   // 11______ 0_______, or 11______ 11______
+#define TOO_LONG        (1<<1)   // 0_______ 10______
+#define OVERLONG_3      (1<<2)   // 11100000 100_____
+#define TOO_LARGE       (1<<3)   // 11110100 1001____, 11110100 101_____, or 11110101+ 10______
+#define SURROGATE       (1<<4)   // 11101101 101_____
+#define OVERLONG_2      (1<<5)   // 1100000_ 10______
+#define TOO_LARGE_1000  (1<<6)   // 11110101+ 1000____
+#define OVERLONG_4      (1<<6)   // 11110000 1000____
+#define TWO_CONTS       (1<<7)   // 10______ 10______
+#define CARRY           (TOO_SHORT|TOO_LONG|TWO_CONTS)
+
+static const __u8x16 utf8_byte_1_high={
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	TOO_SHORT|OVERLONG_2,
+	TOO_SHORT,
+	TOO_SHORT|OVERLONG_3|SURROGATE,
+	TOO_SHORT|TOO_LARGE|TOO_LARGE_1000|OVERLONG_4
+};
+
+static const __u8x16 utf8_byte_1_low={
+	CARRY|OVERLONG_3|OVERLONG_2|OVERLONG_4,
+	CARRY|OVERLONG_2,
+	CARRY,
+	CARRY,
+	CARRY|TOO_LARGE,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000|SURROGATE,
+	CARRY|TOO_LARGE|TOO_LARGE_1000,
+	CARRY|TOO_LARGE|TOO_LARGE_1000
+};
+
+static const __u8x16 utf8_byte_2_high={
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_LONG|OVERLONG_2|TWO_CONTS|OVERLONG_3|TOO_LARGE_1000|OVERLONG_4,
+	TOO_LONG|OVERLONG_2|TWO_CONTS|OVERLONG_3|TOO_LARGE,
+	TOO_LONG|OVERLONG_2|TWO_CONTS|SURROGATE|TOO_LARGE,
+	TOO_LONG|OVERLONG_2|TWO_CONTS|SURROGATE|TOO_LARGE,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+};
+
+// a lead byte in one of the last three positions that needs more bytes than are left in the block
+static const __u8x16 utf8_max_complete={
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0-1, 0xE0-1, 0xC0-1
+};
+
+// returns a non zero byte for each error in input.  prev is the previous block (its last three bytes are used)
+static inline __u8x16 utf8_block_errors(__u8x16 input, __u8x16 prev) {
+	const __u8x16 prev1=__builtin_shufflevector(prev, input, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30);
+	const __u8x16 prev2=__builtin_shufflevector(prev, input, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29);
+	const __u8x16 prev3=__builtin_shufflevector(prev, input, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28);
+	const __u8x16 low_nibble=splat16(0x0F);
+
+	const __u8x16 special_cases=lookup16(utf8_byte_1_high, prev1>>4) & lookup16(utf8_byte_1_low, prev1&low_nibble) & lookup16(utf8_byte_2_high, input>>4);
+	const __u8x16 must_be_continuation=((__u8x16)(prev2>=splat16(0xE0)) | (__u8x16)(prev3>=splat16(0xF0))) & splat16(0x80);
+
+	return must_be_continuation ^ special_cases;
+}
+
+bool twr_utf8_validate(const char* str, size_t len) {
+	const unsigned char* p=(const unsigned char*)str;
+	const __u8x16 zero=splat16(0);
+	__u8x16 prev=zero, errors=zero, incomplete=zero;
+
+	for (; len>=16; p+=16, len-=16) {
+		const __u8x16 input=loadu16(p);
+		if (is_ascii16(input)) {
+			errors|=incomplete;
+		}
+		else {
+			errors|=utf8_block_errors(input, prev);
+			incomplete=(__u8x16)(input>utf8_max_complete);
+		}
+		prev=input;
+	}
+
+	// the last block is padded with zeros, which are ASCII, so a sequence cut short by the end of str is an error
+	__u8x16 last=zero;
+	memcpy(&last, p, len);
+	errors|=utf8_block_errors(last, prev);
+
+	return eq_mask(errors, zero)==0xFFFF;
+}
+
+size_t twr_utf8_count(const char* str, size_t len) {
+	const unsigned char* p=(const unsigned char*)str;
+	const __i8x16 continuation_max=(__i8x16)splat16(0xBF);
+	size_t count=0;
+
+	// continuation bytes (10xxxxxx) are the signed bytes less than -64
+	for (; len>=16; p+=16, len-=16)
+		count+=16-__builtin_popcount(__builtin_wasm_bitmask_i8x16((__i8x16)loadu16(p)<=continuation_max));
+
+	for (; len>0; p++, len--)
+		count+=(*p&0xC0)!=0x80;
+
+	return count;
+}
+
+size_t twr_utf8_to_utf32(const char* str, size_t len, int* out) {
+	const unsigned char* p=(const unsigned char*)str;
+	size_t n=0;
+
+	while (len>0) {
+		if (len>=16) {
+			const __u8x16 input=loadu16(p);
+			if (is_ascii16(input)) {
+				struct __i32x4_unaligned* o=(struct __i32x4_unaligned*)(out+n);
+				o[0].v=__builtin_convertvector(__builtin_shufflevector(input, input, 0, 1, 2, 3), __i32x4);
+				o[1].v=__builtin_convertvector(__builtin_shufflevector(input, input, 4, 5, 6, 7), __i32x4);
+				o[2].v=__builtin_convertvector(__builtin_shufflevector(input, input, 8, 9, 10, 11), __i32x4);
+				o[3].v=__builtin_convertvector(__builtin_shufflevector(input, input, 12, 13, 14, 15), __i32x4);
+				p+=16; len-=16; n+=16;
+				continue;
+			}
+		}
+
+		const int k=utf8_decode(p, len, out+n);
+		if (k==0) out[n]=0xFFFD;
+		n++;
+		p+=k ? k : 1;
+		len-=k ? k : 1;
+	}
+
+	return n;
+}
+
+size_t twr_utf32_to_utf8(const int* str, size_t len, char* out) {
+	unsigned char* o=(unsigned char*)out;
+
+	while (len>0) {
+		if (len>=16) {
+			const struct __i32x4_unaligned* in=(const struct __i32x4_unaligned*)str;
+			const __i32x4 a=in[0].v, b=in[1].v, c=in[2].v, d=in[3].v;
+			const __i32x4 high_bits=(a|b|c|d)&~0x7F;
+			if (eq_mask((__u8x16)high_bits, splat16(0))==0xFFFF) {
+				const __u8x16 ab=__builtin_shufflevector((__u8x16)a, (__u8x16)b, 0, 4, 8, 12, 16, 20, 24, 28, 0, 0, 0, 0, 0, 0, 0, 0);
+				const __u8x16 cd=__builtin_shufflevector((__u8x16)c, (__u8x16)d, 0, 4, 8, 12, 16, 20, 24, 28, 0, 0, 0, 0, 0, 0, 0, 0);
+				((struct __u8x16_unaligned*)o)->v=__builtin_shufflevector(ab, cd, 0, 1, 2, 3, 4, 5, 6, 7, 16, 17, 18, 19, 20, 21, 22, 23);
+				str+=16; len-=16; o+=16;
+				continue;
+			}
+		}
+
+		o+=utf8_encode(*str, o);
+		str++;
+		len--;
+	}
+
+	return o-(unsigned char*)out;
+}
+
+#else
+
+#define HIGH_BITS_64 0x8080808080808080ULL
+
+static inline uint64_t load8(const unsigned char* p) {
+	uint64_t w;
+	memcpy(&w, p, 8);
+	return w;
+}
+
+bool twr_utf8_validate(const char* str, size_t len) {
+	const unsigned char* p=(const unsigned char*)str;
+	int code_point;
+
+	while (len>0) {
+		if (len>=8 && (load8(p)&HIGH_BITS_64)==0) {
+			p+=8; len-=8;
+			continue;
+		}
+
+		const int k=utf8_decode(p, len, &code_point);
+		if (k==0) return false;
+		p+=k; len-=k;
+	}
+
+	return true;
+}
+
+size_t twr_utf8_count(const char* str, size_t len) {
+	const unsigned char* p=(const unsigned char*)str;
+	size_t count=0;
+
+	// continuation bytes (10xxxxxx) have the high bit set, and the next bit clear
+	for (; len>=8; p+=8, len-=8) {
+		const uint64_t w=load8(p);
+		count+=8-__builtin_popcountll(w & ~(w<<1) & HIGH_BITS_64);
+	}
+
+	for (; len>0; p++, len--)
+		count+=(*p&0xC0)!=0x80;
+
+	return count;
+}
+
+size_t twr_utf8_to_utf32(const char* str, size_t len, int* out) {
+	const unsigned char* p=(const unsigned char*)str;
+	size_t n=0;
+
+	while (len>0) {
+		if (len>=8 && (load8(p)&HIGH_BITS_64)==0) {
+			for (int i=0; i<8; i++)
+				out[n++]=p[i];
+			p+=8; len-=8;
+			continue;
+		}
+
+		const int k=utf8_decode(p, len, out+n);
+		if (k==0) out[n]=0xFFFD;
+		n++;
+		p+=k ? k : 1;
+		len-=k ? k : 1;
+	}
+
+	return n;
+}
+
+size_t twr_utf32_to_utf8(const int* str, size_t len, char* out) {
+	unsigned char* o=(unsigned char*)out;
+
+	for (size_t i=0; i<len; i++)
+		o+=utf8_encode(str[i], o);
+
+	return o-(unsigned char*)out;
+}
+#endif
+
 char *strdup(const char * source) {
 	if (source==NULL) return NULL;
 	char * copy = (char *) malloc( strlen(source) + 1 ); 
@@ -126,18 +489,36 @@ int strncmp(const char* lhs, const char* rhs, size_t count) {
 		return strcoll_l(lhs+4+sizeof(struct __locale_t_struct), rhs+4+sizeof(struct __locale_t_struct), loc);
 	}
 
+	// characters compare as unsigned char
+	const unsigned char* l=(const unsigned char*)lhs;
+	const unsigned char* r=(const unsigned char*)rhs;
 	size_t k=0;
 
-	while (1) {
-		int c1=lhs[k];
-		int c2=rhs[k];
-
-		if (c1<c2) return -1;
-		else if (c1>c2) return 1;
-		else if (c1==0 && c2==0) return 0;
+#ifdef __wasm_simd128__
+	const __u8x16 zero=splat16(0);
+#endif
+
+	while (k<count) {
+#ifdef __wasm_simd128__
+		if (LOAD16_WITHIN_PAGE(l+k) && LOAD16_WITHIN_PAGE(r+k)) {
+			const __u8x16 a=loadu16(l+k);
+			const uint32_t stop=(eq_mask(a, loadu16(r+k))^0xFFFF) | eq_mask(a, zero);  // a difference or the end of lhs
+			if (stop==0) {
+				k+=16;
+				continue;
+			}
+			k+=__builtin_ctz(stop);
+			if (k>=count || l[k]==r[k]) return 0;
+			return l[k]<r[k]?-1:1;
+		}
+		// otherwise a load is near a 4KB boundary, so compare a byte at a time until the loads are safe again
+#endif
+		if (l[k]!=r[k]) return l[k]<r[k]?-1:1;
+		if (l[k]==0) return 0;
 		k++;
-		if (k==count) return 0;
-	}	
+	}
+
+	return 0;
 }
 
 int strcmp(const char* string1, const char* string2) {
@@ -163,19 +544,134 @@ int stricmp(const char* string1, const char* string2) {
 	return strnicmp(string1, string2, MAX_SIZE_T);
 }
 
-char *strstr(const char *haystack, const char *needle) {
-	int k=0;
-	int len=strlen(needle);
+/* memmem() and strstr() use the Two-Way algorithm (Crochemore and Perrin), which is O(haystack+needle) for any input. */
+/* The needle is split at a critical factorization into a left and right part. The right part is compared first, */
+/* and a mismatch there skips ahead by the number of bytes matched.  If the right part matches, the left part is  */
+/* compared, and a mismatch there skips ahead by the needle's period.  For periodic needles, the bytes known to    */
+/* match after a skip by the period (memory) aren't compared again.  In addition, the last byte of each window is  */
+/* checked first against a table of the needle's bytes (as in Boyer-Moore-Horspool), which skips ahead quickly in  */
+/* typical text. */
+
+// finds the maximal suffix of needle, using < (or > if reverse is true) to order bytes.  Returns its start-1, and sets *period
+static size_t maximal_suffix(const unsigned char* needle, size_t len, bool reverse, size_t* period) {
+	size_t ms=(size_t)-1;   // start of the suffix minus one
+	size_t j=0, k=1, p=1;
+
+	while (j+k<len) {
+		const unsigned char a=needle[ms+k];
+		const unsigned char b=needle[j+k];
+		if (a==b) {
+			if (k==p) {
+				j+=p;
+				k=1;
+			}
+			else k++;
+		}
+		else if (reverse ? a<b : a>b) {
+			j+=k;
+			k=1;
+			p=j-ms;
+		}
+		else {
+			ms=j++;
+			k=p=1;
+		}
+	}
 
-	while (haystack[k]) {
-		if (strncmp(haystack+k, needle, len)==0)
-			return (char*)(haystack+k);
-		k++;
+	*period=p;
+	return ms;
+}
+
+static void *two_way(const unsigned char* h, size_t hlen, const unsigned char* n, size_t nlen) {
+	const unsigned char* const end=h+hlen;
+
+	// skip[c] is how far the window can move if its last byte is c, so that c lines up with the last c in the needle
+	size_t skip[256];
+	for (int c=0; c<256; c++)
+		skip[c]=nlen;
+	for (size_t i=0; i<nlen; i++)
+		skip[n[i]]=nlen-1-i;
+
+	// critical factorization: the longer of the two maximal suffixes
+	size_t p, p_reverse;
+	size_t ms=maximal_suffix(n, nlen, false, &p);
+	const size_t ms_reverse=maximal_suffix(n, nlen, true, &p_reverse);
+	if (ms_reverse+1 > ms+1) {
+		ms=ms_reverse;
+		p=p_reverse;
+	}
+
+	// memory_after_shift is how many bytes at the start of the window are known to match after a shift by the period
+	size_t memory_after_shift;
+	if (memcmp(n, n+p, ms+1)==0) {
+		memory_after_shift=nlen-p;
+	}
+	else {
+		// the needle isn't periodic with period p, so a larger shift is safe, and there is no memory
+		memory_after_shift=0;
+		p=(ms>nlen-ms-1 ? ms : nlen-ms-1)+1;
+	}
+
+	size_t memory=0;
+	while ((size_t)(end-h)>=nlen) {
+		size_t k=skip[h[nlen-1]];
+		if (k) {
+			if (k<memory) k=memory;
+			h+=k;
+			memory=0;
+			continue;
+		}
+
+		// compare the right part
+		k=ms+1>memory ? ms+1 : memory;
+		while (k<nlen && n[k]==h[k])
+			k++;
+		if (k<nlen) {
+			h+=k-ms;
+			memory=0;
+			continue;
+		}
+
+		// compare the left part
+		k=ms+1;
+		while (k>memory && n[k-1]==h[k-1])
+			k--;
+		if (k<=memory) return (void*)h;
+
+		h+=p;
+		memory=memory_after_shift;
 	}
 
 	return NULL;
 }
 
+void *memmem(const void *haystack, size_t haystacklen, const void *needle, size_t needlelen) {
+	if (needlelen==0) return (void*)haystack;
+	if (needlelen>haystacklen) return NULL;
+
+	const unsigned char* h=haystack;
+	const unsigned char* n=needle;
+
+	// the first byte of the needle has to match, so go straight to it (memchr processes 16 bytes at a time in twr-simd.a)
+	const unsigned char* first=memchr(h, n[0], haystacklen-needlelen+1);
+	if (first==NULL) return NULL;
+	if (needlelen==1) return (void*)first;
+	haystacklen-=first-h;
+
+	return two_way(first, haystacklen, n, needlelen);
+}
+
+char *strstr(const char *haystack, const char *needle) {
+	if (needle[0]==0) return (char*)haystack;
+
+	// the match can't start before the needle's first byte
+	haystack=strchr(haystack, needle[0]);
+	if (haystack==NULL) return NULL;
+	if (needle[1]==0) return (char*)haystack;
+
+	return memmem(haystack, strlen(haystack), needle, strlen(needle));
+}
+
 int strcoll_l(const char* lhs, const char* rhs, locale_t loc) {
 	struct lconv* lcc = __get_lconv_lc_collate(loc);
 	if (__is_c_locale(lcc))  
@@ -215,6 +711,52 @@ size_t strxfrm(char *dest, const char *source, size_t count) {
 	return strxfrm_l(dest, source, count, twr_get_current_locale());
 }
 
+#ifdef __wasm_simd128__
+char *strchr(const char *str, int ch) {
+	const uintptr_t misalign=(uintptr_t)str&15;
+	const unsigned char* p=(const unsigned char*)str-misalign;
+	const __u8x16 c=splat16(ch), zero=splat16(0);
+
+	__u8x16 v=load16(p);
+	uint32_t mask=(eq_mask(v, c)|eq_mask(v, zero))>>misalign;
+	const unsigned char* found=(const unsigned char*)str;
+
+	while (mask==0) {
+		p+=16;
+		v=load16(p);
+		mask=eq_mask(v, c)|eq_mask(v, zero);
+		found=p;
+	}
+
+	found+=__builtin_ctz(mask);
+	return *found==(unsigned char)ch ? (char *)found : NULL;
+}
+
+void *memchr(const void *ptr, int ch, size_t count) {
+	if (count==0) return NULL;
+
+	const uintptr_t misalign=(uintptr_t)ptr&15;
+	const unsigned char* p=(const unsigned char*)ptr-misalign;
+	const __u8x16 c=splat16(ch);
+
+	uint32_t mask=eq_mask(load16(p), c)>>misalign;
+	const unsigned char* block=ptr;   // the byte that bit 0 of mask is for
+	size_t block_len=16-misalign;
+
+	while (1) {
+		if (mask) {
+			const size_t i=__builtin_ctz(mask);
+			return i<count ? (void *)(block+i) : NULL;
+		}
+		if (count<=block_len) return NULL;
+		count-=block_len;
+		p+=16;
+		block=p;
+		block_len=16;
+		mask=eq_mask(load16(p), c);
+	}
+}
+#else
 char *strchr(const char *str, int ch) {
 	const char c=ch;
 	while (1) {
@@ -237,43 +779,12 @@ void *memchr(const void *ptr, int ch, size_t count) {
 
 	return NULL;
 }
+#endif
 
-// memeset() uses the .wat code in twr-wasm-c
-// memcpy() uses the .wat code in twr-wasm-c
-
-void *memmove(void *dest, const void *src, size_t n)
-{
-	uint8_t* from = (uint8_t*)src;
-	uint8_t* to = (uint8_t*)dest;
-
-	if (from == to || n == 0)
-		return dest;
-
-	else if (to > from && to-from < (int)n) {
-		/* to overlaps with from */
-		/*  <from......>         */
-		/*         <to........>  */
-		/* copy in reverse, to avoid overwriting from */
-		int i;
-		for(i=n-1; i>=0; i--)
-			to[i] = from[i];
-		return dest;
-	}
-	else if (from > to && from-to < (int)n) {
-		/* to overlaps with from */
-		/*        <from......>   */
-		/*  <to........>         */
-		/* copy forwards, to avoid overwriting from */
-		size_t i;
-		for(i=0; i<n; i++)
-			to[i] = from[i];
-		return dest;
-	}
-	else {
-		memcpy(dest, src, n);
-		return dest;
-	}
-}
+// memset() uses the .wat code in twr-stdclib
+// memcpy() uses the .wat code in twr-stdclib
+// memmove() uses the .wat code in twr-stdclib (memory.copy handles overlapping regions)
+// bzero() uses the .wat code in twr-stdclib
 
 // Negative value if lhs appears before rhs in lexicographical order.
 // Zero if lhs and rhs compare equal, or if count is zero.
@@ -283,6 +794,24 @@ int memcmp( const void* lhs, const void* rhs, size_t count ) {
 	const unsigned char* r=rhs;
 	size_t k=0;
 
+#ifdef __wasm_simd128__
+	for (; k+16<=count; k+=16) {
+		const uint32_t diff=eq_mask(loadu16(l+k), loadu16(r+k))^0xFFFF;
+		if (diff) {
+			k+=__builtin_ctz(diff);
+			return l[k]<r[k]?-1:1;
+		}
+	}
+#else
+	// skip equal 8 byte words, then find the differing byte below (wasm allows unaligned loads)
+	for (; k+8<=count; k+=8) {
+		uint64_t wl, wr;
+		memcpy(&wl, l+k, 8);
+		memcpy(&wr, r+k, 8);
+		if (wl!=wr) break;
+	}
+#endif
+
 	while (1) {
 		if (k==count) return 0;
 
@@ -295,7 +824,212 @@ int memcmp( const void* lhs, const void* rhs, size_t count ) {
 	}	
 }
 
+// compare strlen, strchr, memchr, memcmp, strcmp, and strncmp with byte at a time versions,
+// at every alignment, and with strings that end at the end of a 16 byte block or near a 4KB boundary
+static int ref_cmp(const unsigned char* l, const unsigned char* r, size_t count, bool stop_at_zero) {
+	for (size_t k=0; k<count; k++) {
+		if (l[k]!=r[k]) return l[k]<r[k]?-1:1;
+		if (stop_at_zero && l[k]==0) return 0;
+	}
+	return 0;
+}
+
+static int string_kernels_test(void) {
+	static unsigned char buf[4096+64] __attribute__((aligned(16)));
+	static unsigned char buf2[128] __attribute__((aligned(16)));
+
+	for (int start=0; start<32; start++) {
+		for (int len=0; len<64; len++) {
+			memset(buf, 0x01, 128);
+			for (int i=0; i<len; i++)
+				buf[start+i]=(unsigned char)(i*7+1)|0x20;   // never 0 or 1
+			buf[start+len]=0;
+			const char* str=(const char*)buf+start;
+
+			if (strlen(str)!=(size_t)len) return 0;
+
+			for (int i=0; i<len; i++) {
+				if (strchr(str, buf[start+i])!=(char*)memchr(str, buf[start+i], len)) return 0;
+				const unsigned char* first=buf+start;
+				while (*first!=buf[start+i]) first++;
+				if (strchr(str, buf[start+i])!=(const char*)first) return 0;
+				if (memchr(str, buf[start+i], first-(buf+start))!=NULL) return 0;
+			}
+			if (strchr(str, 0)!=str+len) return 0;
+			if (strchr(str, 0x01)!=NULL) return 0;
+			if (memchr(str, 0x01, len)!=NULL) return 0;
+			if (memchr(str, 0x01, len+2)!=str+len+1) return 0;
+
+			// compare with a copy at every other alignment, with and without a difference at each position
+			for (int start2=0; start2<16; start2++) {
+				memset(buf2, 'y', sizeof(buf2));
+				memcpy(buf2+start2, str, len+1);
+				const char* str2=(const char*)buf2+start2;
+				if (strcmp(str, str2)!=0 || memcmp(str, str2, len+1)!=0) return 0;
+				if (strncmp(str, str2, len+10)!=0) return 0;
+				for (int i=0; i<=len; i+=(len/5)+1) {
+					buf2[start2+i]=(i&1)?0xE9:0x05;    // greater than, or less than, any character in str
+					const int expect=ref_cmp((const unsigned char*)str, (const unsigned char*)str2, len+1, true);
+					if (strcmp(str, str2)!=expect || strcmp(str2, str)!=-expect) return 0;
+					if (strncmp(str, str2, i)!=0 || strncmp(str, str2, i+1)!=expect) return 0;
+					if (memcmp(str, str2, len+1)!=ref_cmp((const unsigned char*)str, (const unsigned char*)str2, len+1, false)) return 0;
+					if (memcmp(str, str2, i)!=0) return 0;
+					buf2[start2+i]=str[i];
+				}
+			}
+		}
+	}
+
+	// strings that cross a 4KB boundary
+	for (int start=4096-40; start<4096; start++) {
+		memset(buf, 'z', sizeof(buf));
+		buf[4096+20]=0;
+		const char* str=(const char*)buf+start;
+		const size_t len=4096+20-start;
+		if (strlen(str)!=len) return 0;
+		memset(buf2, 'z', len);
+		buf2[len]=0;
+		if (strcmp(str, (const char*)buf2)!=0 || strncmp((const char*)buf2, str, len+1)!=0) return 0;
+		buf2[len-1]='a';
+		if (strcmp(str, (const char*)buf2)!=1 || memcmp(buf2, str, len)!=-1) return 0;
+		if (strchr(str, 0)!=(const char*)buf+4096+20) return 0;
+	}
+
+	return 1;
+}
+
+static const char* ref_memmem(const char* h, size_t hlen, const char* n, size_t nlen) {
+	for (size_t i=0; i+nlen<=hlen; i++)
+		if (ref_cmp((const unsigned char*)h+i, (const unsigned char*)n, nlen, false)==0) return h+i;
+	return NULL;
+}
+
+// strstr and memmem, with random needles from small alphabets (which have many partial matches),
+// and the inputs that make a naive search O(haystack*needle)
+static int strstr_test(void) {
+	static char h[8192+1], n[1024+1];
+
+	uint32_t seed=1;
+	for (int test=0; test<3000; test++) {
+		seed=seed*1103515245+12345;
+		const int alphabet=2+(seed>>16)%3;
+		const size_t hlen=(seed>>8)%200;
+		const size_t nlen=1+(seed>>20)%12;
+		for (size_t i=0; i<hlen; i++) {
+			seed=seed*1103515245+12345;
+			h[i]='a'+(seed>>16)%alphabet;
+		}
+		for (size_t i=0; i<nlen; i++) {
+			seed=seed*1103515245+12345;
+			n[i]='a'+(seed>>16)%alphabet;
+		}
+		// often take the needle from the haystack
+		if ((test&1) && nlen<=hlen) memcpy(n, h+(seed>>8)%(hlen-nlen+1), nlen);
+		h[hlen]=0;
+		n[nlen]=0;
+
+		const char* expect=ref_memmem(h, hlen, n, nlen);
+		if (memmem(h, hlen, n, nlen)!=expect) return 0;
+		if (strstr(h, n)!=expect) return 0;
+	}
+
+	// aaaa...a searched for aaa...ab, and for baaa...a
+	memset(h, 'a', 8192);
+	h[8192]=0;
+	memset(n, 'a', 1024);
+	n[1024]=0;
+	n[1023]='b';
+	if (strstr(h, n)!=NULL || memmem(h, 8192, n, 1024)!=NULL) return 0;
+	n[1023]='a';
+	n[0]='b';
+	if (strstr(h, n)!=NULL || memmem(h, 8192, n, 1024)!=NULL) return 0;
+	h[4000]='b';
+	if (strstr(h, n)!=h+4000 || memmem(h, 8192, n, 1024)!=h+4000) return 0;
+	n[0]='a';
+	n[1023]='b';
+	if (strstr(h, n)!=h+4000-1023 || memmem(h, 8192, n, 1024)!=h+4000-1023) return 0;
+
+	// periodic needle: (ab)^511 c in (ab)^4096
+	for (int i=0; i<8192; i++)
+		h[i]="ab"[i&1];
+	for (int i=0; i<1023; i++)
+		n[i]="ab"[i&1];
+	n[1023]='c';
+	if (strstr(h, n)!=NULL || memmem(h, 8192, n, 1024)!=NULL) return 0;
+	h[5000+1023]='c';
+	if (strstr(h, n)!=h+5000 || memmem(h, 8192, n, 1024)!=h+5000) return 0;
+
+	const char* abc="abc";
+	if (strstr(abc, "")!=abc) return 0;
+	if (memmem("abc", 3, "", 0)==NULL) return 0;
+	if (memmem("abc", 3, "abcd", 4)!=NULL) return 0;
+	if (memmem("ab\0cd", 5, "\0c", 2)==NULL) return 0;
+
+	return 1;
+}
+
+static int utf8_test(void) {
+	static char s[1024+16], back[4*1024];
+	static int u[1024+16];
+	static const char* pieces[]={"a", "Z ", "\xC3\xA4", "\xE2\x82\xAC", "\xF0\x9F\x98\x8A", "\xDF\xBF", "\xEF\xBF\xBF", "\xF4\x8F\xBF\xBF", "\xE0\xA0\x80", "\xF0\x90\x80\x80", "\xED\x9F\xBF", "\xEE\x80\x80"};
+	static const int piece_code_points[]={'a', 'Z', 0xE4, 0x20AC, 0x1F60A, 0x7FF, 0xFFFF, 0x10FFFF, 0x800, 0x10000, 0xD7FF, 0xE000};
+	static int expected[1024];
+
+	// random mixes of valid characters, with long ASCII runs, validate, count, and convert both ways
+	uint32_t seed=1;
+	for (int trial=0; trial<300; trial++) {
+		size_t len=0, count=0;
+		const int target=trial<100 ? trial : (trial*7)%1000;
+		while ((int)len<target) {
+			seed=seed*1103515245+12345;
+			const int i=(seed>>16)%16<8 ? 0 : (seed>>20)%12;
+			if (len+strlen(pieces[i])>1024) break;
+			strcpy(s+len, pieces[i]);
+			len+=strlen(pieces[i]);
+			expected[count++]=piece_code_points[i];
+			if (i==1) expected[count++]=' ';
+		}
+		if (!twr_utf8_validate(s, len)) return 0;
+		if (twr_utf8_count(s, len)!=count) return 0;
+		if (twr_utf8_to_utf32(s, len, u)!=count) return 0;
+		if (memcmp(u, expected, count*sizeof(int))!=0) return 0;
+		if (twr_utf32_to_utf8(u, count, back)!=len) return 0;
+		if (memcmp(back, s, len)!=0) return 0;
+	}
+
+	// malformed sequences, at every position around a 16 byte block boundary
+	static const char* bad[]={"\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xED\xA0\x80", "\xED\xBF\xBF",
+		"\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF8", "\xFF", "\xC3", "\xC3 ", "\xE2\x82", "\xE2\x82 ",
+		"\xF0\x9F\x98", "\xF0\x9F\x98 ", "\xC3\xA4\xA4", "\xE2\x82\xAC\x80", "\xF0\x9F\x98\x8A\x80"};
+	for (int i=0; i<(int)(sizeof(bad)/sizeof(bad[0])); i++) {
+		for (int pos=0; pos<40; pos++) {
+			memset(s, 'x', 64);
+			memcpy(s+pos, bad[i], strlen(bad[i]));
+			if (twr_utf8_validate(s, 64)) return 0;
+			if (twr_utf8_validate(s, pos+strlen(bad[i]))) return 0;
+		}
+	}
+	if (!twr_utf8_validate("", 0)) return 0;
+	if (!twr_utf8_validate("\xE2\x82\xAC", 3) || twr_utf8_validate("\xE2\x82\xAC", 2)) return 0;
+
+	// bytes that aren't part of a valid sequence convert to U+FFFD, and U+FFFD replaces code points that UTF-8 can't encode
+	if (twr_utf8_to_utf32("a\x80\xE2\x82z", 5, u)!=5) return 0;
+	if (u[0]!='a' || u[1]!=0xFFFD || u[2]!=0xFFFD || u[3]!=0xFFFD || u[4]!='z') return 0;
+	const int invalid[]={0xD800, 0x110000, -1, 'b'};
+	if (twr_utf32_to_utf8(invalid, 4, back)!=10) return 0;
+	if (memcmp(back, "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD" "b", 10)!=0) return 0;
+
+	// malformed input is counted, not asserted on
+	if (twr_utf8_count("a\x80\xE2\x82\xAC\xFF", 6)!=3) return 0;
+
+	return 1;
+}
+
 int string_unit_test() {
+	if (!string_kernels_test()) return 0;
+	if (!strstr_test()) return 0;
+	if (!utf8_test()) return 0;
+
 	if (strcmp("a","a")!=0) return 0;
 	if (strcmp("aaa","aaz")>=0) return 0;
 	if (strcmp("aaz","aaa")<=0) return 0;
@@ -329,6 +1063,15 @@ int string_unit_test() {
 	if (dest[3]!=0) return 0;
 	if (strcmp(dest, "321")!=0) return 0;
 
+	// overlapping moves in both directions
+	memcpy(dest, "0123456789", 11);
+	memmove(dest+2, dest, 6);
+	if (strcmp(dest, "0101234589")!=0) return 0;
+	memmove(dest, dest+3, 7);
+	if (strcmp(dest, "1234589589")!=0) return 0;
+	bzero(dest+4, 3);
+	if (memcmp(dest, "1234\0\0\0589", 11)!=0) return 0;
+
 	//  errno.c
 	if (strcmp(strerror(0), "No error")!=0) return 0;
 	if (strcmp(strerror(999999), "Unknown error code")!=0) return 0;
@@ -374,6 +1117,7 @@ int string_unit_test() {
 	if (twr_utf8_char_len("あ")!=3) return 0;
 	if (twr_utf8_char_len("𐍈")!=4) return 0;
 	if (twr_mbslen_l("a𐍈bあ", loc)!=4) return 0;
+	if (twr_mbslen_l("a\x80" "b\xFF", loc)!=3) return 0;
 	
 	freelocale(loc);
 
@@ -46,11 +46,7 @@ int atof_unit_test() {
 	if (atof("0.0")!= 0.0) return 0;
 	if (atof("0")!= 0) return 0;
 
-#ifdef __wasm__
-	if (!isnan(atof("junk"))) return 0;
-#else
 	if (atof("junk")!= 0) return 0;
-#endif
 
 	if (atof("-0x1afp-2")!= 0) return 0;
 	if (atof("  -0.0000000123junk")!=-0.0000000123) return 0;
@@ -104,13 +100,11 @@ int twr_dtoa_unit_test() {
 	twr_dtoa(buffer, sizeof(buffer), 123456789.0123456, -1);
 	if (strcmp(buffer, "123456789.0123456")!=0) return 0;
 
-#ifdef __wasm__
 	twr_dtoa(buffer, sizeof(buffer), 0.0000003, -1);
 	if (strcmp(buffer, "3e-7")!=0) return 0;
-#else
+
 	twr_dtoa(buffer, sizeof(buffer), 0.000003, -1);
-	if (strcmp(buffer, "3E-6")!=0) return 0;
-#endif
+	if (strcmp(buffer, "0.000003")!=0) return 0;
 
 	twr_dtoa(buffer, sizeof(buffer), 123, -1);
 	if (strcmp(buffer, "123")!=0) return 0;
@@ -207,14 +201,8 @@ int twr_dtoa_unit_test() {
 	twr_dtoa(buffer, sizeof(buffer), 0.1, 6);
 	if (strcmp(buffer, "0.1")!=0) return 0;
 
-//!!!! WHICH ONE IS RIGHT?
-#ifdef __wasm__
-	twr_dtoa(buffer, sizeof(buffer), 0.1f, 6);
+	twr_dtoa(buffer, sizeof(buffer), 0.1f, 6);  // 0.10000000149011612 is longer than 6, so toPrecision(6) is used
 	if (strcmp(buffer, "0.100000")!=0) return 0;
-#else
-	twr_dtoa(buffer, sizeof(buffer), 0.1f, 6);
-	if (strcmp(buffer, "0.1")!=0) return 0;
-#endif
 
 	twr_dtoa(buffer, sizeof(buffer), 1.0/3.0, 6);
 	if (strcmp(buffer, "0.333333")!=0) return 0;
@@ -230,7 +218,85 @@ int twr_dtoa_unit_test() {
 
 	twr_dtoa(buffer, sizeof(buffer), 100000.33333, 6);
 	if (strcmp(buffer, "100000")!=0) return 0;
-	
+
+	twr_dtoa(buffer, sizeof(buffer), 0.000001234, 3);
+	if (strcmp(buffer, "0.00000123")!=0) return 0;
+
+	twr_dtoa(buffer, sizeof(buffer), 123456789, 4);
+	if (strcmp(buffer, "1.235e+8")!=0) return 0;
+
+	// large values
+
+	twr_dtoa(buffer, sizeof(buffer), 1e20, -1);
+	if (strcmp(buffer, "100000000000000000000")!=0) return 0;
+
+	twr_dtoa(buffer, sizeof(buffer), 1e21, -1);
+	if (strcmp(buffer, "1e+21")!=0) return 0;
+
+	twr_dtoa(buffer, sizeof(buffer), 1.7976931348623157e308, -1);
+	if (strcmp(buffer, "1.7976931348623157e+308")!=0) return 0;
+
+	// output is truncated to fit the buffer
+
+	twr_dtoa(buffer, 8, 1.0/3.0, -1);
+	if (strcmp(buffer, "0.33333")!=0) return 0;
+
+	// twr_tofixed
+
+	twr_tofixed(buffer, sizeof(buffer), 1.005, 2);  // 1.005 is 1.00499999999999989...
+	if (strcmp(buffer, "1.00")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), 1.45, 1);
+	if (strcmp(buffer, "1.4")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), 2.5, 0);
+	if (strcmp(buffer, "3")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), 0.5, 0);
+	if (strcmp(buffer, "1")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), 999.996, 2);
+	if (strcmp(buffer, "1000.00")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), -0.0001, 2);
+	if (strcmp(buffer, "-0.00")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), 0.1, 20);
+	if (strcmp(buffer, "0.10000000000000000555")!=0) return 0;
+
+	twr_tofixed(buffer, sizeof(buffer), 1e21, 2);
+	if (strcmp(buffer, "1e+21")!=0) return 0;
+
+	// twr_toexponential
+
+	twr_toexponential(buffer, sizeof(buffer), 0, 2);
+	if (strcmp(buffer, "0.00e+0")!=0) return 0;
+
+	twr_toexponential(buffer, sizeof(buffer), 123456, 2);
+	if (strcmp(buffer, "1.23e+5")!=0) return 0;
+
+	twr_toexponential(buffer, sizeof(buffer), 9.9999, 2);
+	if (strcmp(buffer, "1.00e+1")!=0) return 0;
+
+	twr_toexponential(buffer, sizeof(buffer), 0X0.0000000000001P-1022, 3);
+	if (strcmp(buffer, "4.941e-324")!=0) return 0;
+
+	twr_toexponential(buffer, sizeof(buffer), -twr_infval(), 3);
+	if (strcmp(buffer, "-Infinity")!=0) return 0;
+
+	// the shortest text converts back to the same double
+
+	uint64_t bits=88172645463325252ULL;
+	for (int i=0; i<1000; i++) {
+		bits^=bits<<13;
+		bits^=bits>>7;
+		bits^=bits<<17;
+		memcpy(&dv, &bits, sizeof(dv));
+		if (dv!=dv || dv==twr_infval() || dv==-twr_infval()) continue;
+		twr_dtoa(buffer, sizeof(buffer), dv, -1);
+		if (atof(buffer)!=dv) return 0;
+	}
+
 	return 1;
 }
 
@@ -297,11 +363,7 @@ int fcvt_unit_test() {
 	if (!fcvt_expect(buffer, dec, sign, error, "100000000000",  -18, 0)) return 0;
 	
 	error=_fcvt_s(buffer, sizeof(buffer), (double)6.54321e+200, 10, &dec, &sign);  
-#ifdef __wasm__
-	if (error==0) return 0;
-#else
 	if (!fcvt_expect(buffer, dec, sign, error, "6543209999999999561461578727841808536676238014554206487411164761511588201120188491102838911919793884914712609471921587675606823921054952492339799962922243734546177255394661967753070612297755130981253120000000000",  201, 0)) return 0;
-#endif
 
 	error=_fcvt_s(buffer, sizeof(buffer)/3, (double)6.54321e+200, 10, &dec, &sign);
 	if (0==error ) return 0;
@@ -309,38 +371,21 @@ int fcvt_unit_test() {
 	error=_fcvt_s(buffer, sizeof(buffer), (double)1.23e-90, 93, &dec, &sign); 
 	if (!fcvt_expect(buffer, dec, sign, error, "1230",  -89, 0)) return 0;  // not sure what correct behaviour for dec should be in this case
 
-#ifdef __wasm__
+	// when the value rounds to zero, the result is empty and dec is -fracpart_numdigits
 	error=_fcvt_s(buffer, sizeof(buffer), (double)1.23e-20, 3, &dec, &sign); 
-	if (!fcvt_expect(buffer, dec, sign, error, "",  -3, 0)) return 0;  // not sure what correct behaviour for dec should be in this case
-#endif
+	if (!fcvt_expect(buffer, dec, sign, error, "",  -3, 0)) return 0;
 
 	error=_fcvt_s(buffer, sizeof(buffer), (double)0.0005, 2, &dec, &sign); 
-#ifdef __wasm__
 	if (!fcvt_expect(buffer, dec, sign, error, "",  -2, 0)) return 0;
-#else
-	if (!fcvt_expect(buffer, dec, sign, error, "",  -3, 0)) return 0;
-#endif
 
 	error=_fcvt_s(buffer, sizeof(buffer), (double)6.54321e-200, 10, &dec, &sign); 
-#ifdef __wasm__
-	if (error==0) return 0;
-#else
-	if (!fcvt_expect(buffer, dec, sign, error, "",  -199, 0)) return 0;
-#endif
+	if (!fcvt_expect(buffer, dec, sign, error, "",  -10, 0)) return 0;
 
 	error=_fcvt_s(buffer, sizeof(buffer), (double)6.54321e-200, 210, &dec, &sign); 
-#ifdef __wasm__
-	if (error==0) return 0;
-#else
 	if (!fcvt_expect(buffer, dec, sign, error, "65432100000",  -199, 0)) return 0;
-#endif
 
 	error=_fcvt_s(buffer, sizeof(buffer), (double)3.6e-310, 350, &dec, &sign); // un-normalized
-#ifdef __wasm__
-	if (error==0) return 0;
-#else
 	if (!fcvt_expect(buffer, dec, sign, error, "36000000000000087643837346930308760325595",  -309, 0)) return 0;
-#endif
 
 	error=_fcvt_s(buffer, sizeof(buffer), 0, 1, &dec, &sign);   // test zero (which is denormalized)
 	if (!fcvt_expect(buffer, dec, sign, error, "0",  0, 0)) return 0;
@@ -165,6 +165,10 @@ export class twrLibraryProxy {
    private remoteProcedureCall(ownerMod:twrWasmModuleAsyncProxy, funcName:string, isAsyncFunction:boolean, returnValueEventID:number, interfaceName:string|undefined, ...args:any[]) {
       let msg:TLibraryMessage;
 
+      // an async function blocks the C code (eg. twr_sleep), so first display any output the C code has buffered
+      if (isAsyncFunction)
+         ownerMod.wasmCall.flushOutput();
+
       if (interfaceName)
          msg=["twrLibrary", args[0], funcName, isAsyncFunction, returnValueEventID, ...args.slice(1)];
       else
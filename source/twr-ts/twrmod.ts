@@ -3,7 +3,7 @@ import {IConsole, logToCon} from "./twrcon.js"
 import {twrLibraryInstanceRegistry} from "./twrlibrary.js";
 import {IWasmMemory} from './twrwasmmem.js'
 import {twrWasmCall} from "./twrwasmcall.js"
-import {twrWasmBase, TOnEventCallback} from "./twrwasmbase.js"
+import {twrWasmBase, TOnEventCallback, ILoadWasmOpts} from "./twrwasmbase.js"
 import {twrEventQueueReceive} from "./twreventqueue.js"
 import {twrLibBuiltIns} from "./twrlibbuiltin.js"
 
@@ -18,7 +18,7 @@ export interface IWasmModule extends Partial<IWasmMemory> {
    callC:twrWasmCall["callC"];
    isTwrWasmModuleAsync:false;   // to avoid circular references -- check if twrWasmModule without importing twrWasmModule
    //TODO!! put these into IWasmModuleBase (some could be implemented in twrWasmModuleBase, but many have different implementations)
-   loadWasm: (pathToLoad:string)=>Promise<void>;
+   loadWasm: (pathToLoad:string, opts?:ILoadWasmOpts)=>Promise<void>;
    postEvent: TOnEventCallback;
    fetchAndPutURL: (fnin:URL)=>Promise<[number, number]>;
    divLog:(...params: string[])=>void;
@@ -40,9 +40,9 @@ export class twrWasmModule extends twrWasmBase implements IWasmModule {
    // IWasmMemory
    // These are deprecated, use wasmMem instead.
    memory!:WebAssembly.Memory;
-   mem8!:Uint8Array;
-   mem32!:Uint32Array;
-   memD!:Float64Array;
+   get mem8() { return this.wasmMem.mem8; }
+   get mem32() { return this.wasmMem.mem32; }
+   get memD() { return this.wasmMem.memD; }
    stringToU8!:(sin:string, codePage?:number)=>Uint8Array;
    copyString!:(buffer:number, buffer_size:number, sin:string, codePage?:number)=>void;
    getLong!:(idx:number)=>number;
@@ -71,7 +71,7 @@ export class twrWasmModule extends twrWasmBase implements IWasmModule {
 
    /*********************************************************************/
 
-   async loadWasm(pathToLoad:string) {
+   async loadWasm(pathToLoad:string, opts:ILoadWasmOpts={}) {
 
       // load builtin libraries
       await twrLibBuiltIns();
@@ -96,16 +96,13 @@ export class twrWasmModule extends twrWasmBase implements IWasmModule {
          twrConGetIDFromName: twrConGetIDFromNameImpl,
       }
 
-      await super.loadWasm(pathToLoad, imports);
+      await super.loadWasm(pathToLoad, imports, opts);
 
       if (!(this.wasmMem.memory.buffer instanceof ArrayBuffer))
          console.log("twrWasmModule does not require shared Memory. Okay to remove wasm-ld --shared-memory --no-check-features");
 
       // backwards compatible
       this.memory = this.wasmMem.memory;
-      this.mem8 = this.wasmMem.mem8;
-      this.mem32 = this.wasmMem.mem32;
-      this.memD = this.wasmMem.memD;
       this.malloc = this.wasmMem.malloc;
       this.free = this.wasmMem.free;
       this.stringToU8=this.wasmMem.stringToU8;
@@ -156,8 +153,10 @@ export class twrWasmModule extends twrWasmBase implements IWasmModule {
          throw new Error("twrWasmModule.postEvent called with invalid eventID: "+eventID+", params: "+params);
 
       const onEventCallback=twrEventQueueReceive.onEventCallbacks[eventID];
-      if (onEventCallback) 
+      if (onEventCallback) {
          onEventCallback(eventID, ...params);
+         this.wasmCall.flushOutput();
+      }
       else
          throw new Error("twrWasmModule.postEvent called with undefined callback.  eventID: "+eventID+", params: "+params);
    }
@@ -6,6 +6,7 @@ import {twrWasmModuleCallAsync, TCallCAsync, TCallCImplAsync } from "./twrwasmca
 import {TLibraryMessage, TLibraryProxyParams, twrLibraryInstanceRegistry} from "./twrlibrary.js"
 import {twrEventQueueSend} from "./twreventqueue.js"
 import {twrLibBuiltIns} from "./twrlibbuiltin.js"
+import {ILoadWasmOpts} from "./twrwasmbase.js"
 
 // class twrWasmModuleAsync consist of two parts:
 //   twrWasmModuleAsync runs in the main JavaScript event loop
@@ -28,7 +29,7 @@ export interface IWasmModuleAsync extends Partial<IWasmMemoryAsync> {
    eventQueueSend:twrEventQueueSend;
    isTwrWasmModuleAsync:true;  // to avoid circular references -- check if twrWasmModuleAsync without importing twrWasmModuleAsync
    //TODO!! put these into IWasmModuleBase (some could be implemented in twrWasmModuleBase, but many have different implementations)
-   loadWasm: (pathToLoad:string)=>Promise<void>;
+   loadWasm: (pathToLoad:string, opts?:ILoadWasmOpts)=>Promise<void>;
    postEvent:(eventID:number, ...params:number[])=>void;
    fetchAndPutURL: (fnin:URL)=>Promise<[number, number]>;
    divLog:(...params: string[])=>void;
@@ -37,6 +38,7 @@ export interface IWasmModuleAsync extends Partial<IWasmMemoryAsync> {
 
 export type TModAsyncProxyStartupMsg = {
    urlToLoad: string,
+   loadWasmOpts: ILoadWasmOpts,
    allProxyParams: IAllProxyParams,
 };
 
@@ -68,9 +70,9 @@ export class twrWasmModuleAsync implements IWasmModuleAsync {
    // These are deprecated, use wasmMem instead.
    memory!:WebAssembly.Memory;
    exports!:WebAssembly.Exports;
-   mem8!:Uint8Array;
-   mem32!:Uint32Array;
-   memD!:Float64Array;
+   get mem8() { return this.wasmMem.mem8; }
+   get mem32() { return this.wasmMem.mem32; }
+   get memD() { return this.wasmMem.memD; }
    stringToU8!:(sin:string, codePage?:number)=>Uint8Array;
    copyString!:(buffer:number, buffer_size:number, sin:string, codePage?:number)=>void;
    getLong!:(idx:number)=>number;
@@ -109,7 +111,7 @@ export class twrWasmModuleAsync implements IWasmModuleAsync {
       this.divLog=this.log;
    }
 
-   async loadWasm(pathToLoad:string) {
+   async loadWasm(pathToLoad:string, opts:ILoadWasmOpts={}) {
       if (this.initLW) 	throw new Error("twrWasmModuleAsync::loadWasm can only be called once per instance");
       this.initLW=true;
 
@@ -133,7 +135,7 @@ export class twrWasmModuleAsync implements IWasmModuleAsync {
             eventQueueBuffer: this.eventQueueSend.circBuffer.saBuffer
          };
          const urlToLoad = new URL(pathToLoad, document.URL);
-         const startMsg:TModAsyncProxyStartupMsg={ urlToLoad: urlToLoad.href, allProxyParams: allProxyParams};
+         const startMsg:TModAsyncProxyStartupMsg={ urlToLoad: urlToLoad.href, loadWasmOpts: opts, allProxyParams: allProxyParams};
          this.myWorker.postMessage(['startup', startMsg]);
       });
    }
@@ -222,9 +224,6 @@ export class twrWasmModuleAsync implements IWasmModuleAsync {
                this.callCInstance=new twrWasmModuleCallAsync(this.wasmMem, this.callCImpl.bind(this));
 
                // backwards compatible
-               this.mem8 = this.wasmMem.mem8;
-               this.mem32 = this.wasmMem.mem32;
-               this.memD = this.wasmMem.memD;
                this.stringToU8=this.wasmMem.stringToU8;
                this.copyString=this.wasmMem.copyString;
                this.getLong=this.wasmMem.getLong;
@@ -1,5 +1,5 @@
 import {TModAsyncProxyStartupMsg} from "./twrmodasync.js"
-import {twrWasmBase} from "./twrwasmbase.js"
+import {twrWasmBase, ILoadWasmOpts} from "./twrwasmbase.js"
 import {TLibraryProxyParams, twrLibraryProxy, twrLibraryInstanceProxyRegistry} from "./twrlibrary.js"
 import {twrEventQueueReceive} from "./twreventqueue.js"
 export interface IAllProxyParams {
@@ -20,7 +20,7 @@ self.onmessage = function(e:MessageEvent<[string, ...params:any]>) {
         //console.log("Worker startup params:",params);
         mod=new twrWasmModuleAsyncProxy(startMsg.allProxyParams);
 
-        mod.loadWasm(startMsg.urlToLoad).then( ()=> {
+        mod.loadWasm(startMsg.urlToLoad, startMsg.loadWasmOpts).then( ()=> {
             postMessage(["twrWasmModule", undefined, "startupOkay"]);
         }).catch( (ex)=> {
             console.log(".catch: ", ex);
@@ -63,7 +63,7 @@ export class twrWasmModuleAsyncProxy extends twrWasmBase {
 
    }
          
-   async loadWasm(pathToLoad: string): Promise<void> {
+   async loadWasm(pathToLoad: string, opts:ILoadWasmOpts={}): Promise<void> {
 
       // create twrLibraryProxy versions for each twrLibrary
       for (let i=0; i<this.allProxyParams.libProxyParams.length; i++) {
@@ -88,7 +88,7 @@ export class twrWasmModuleAsyncProxy extends twrWasmBase {
          twrConGetIDFromName: twrConGetIDFromNameImpl,
       }
    
-      await super.loadWasm(pathToLoad, imports);
+      await super.loadWasm(pathToLoad, imports, opts);
 
       // SharedArrayBuffer required for twrWasmModuleAsync/twrWasmModuleAsyncProxy
       // instanceof SharedArrayBuffer doesn't work when crossOriginIsolated not enable, and will cause a runtime error
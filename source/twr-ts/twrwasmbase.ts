@@ -10,6 +10,45 @@ import { twrEventQueueReceive } from './twreventqueue.js';
 
 export type TOnEventCallback = (eventID:number, ...args:number[])=>void;
 
+// A small module that uses each feature twr-simd.a is built with: v128 (i8x16.splat), memory.fill (bulk memory),
+// i32.trunc_sat_f32_s (non-trapping float to int), and i32.extend8_s (sign extension).
+const simdFeaturesProbe=new Uint8Array([
+   0x00, 0x61, 0x73, 0x6d, 0x01, 0x00, 0x00, 0x00,    // magic, version
+   0x01, 0x04, 0x01, 0x60, 0x00, 0x00,                // type section: ()->()
+   0x03, 0x02, 0x01, 0x00,                            // function section
+   0x05, 0x03, 0x01, 0x00, 0x01,                      // memory section: 1 page
+   0x0a, 0x1e, 0x01, 0x1c, 0x00,                      // code section, one body with no locals
+   0x41, 0x00, 0xfd, 0x0f, 0x1a,                      // i32.const 0, i8x16.splat, drop
+   0x41, 0x00, 0x41, 0x00, 0x41, 0x00, 0xfc, 0x0b, 0x00,    // i32.const 0 (x3), memory.fill
+   0x43, 0x00, 0x00, 0x00, 0x00, 0xfc, 0x00, 0x1a,    // f32.const 0, i32.trunc_sat_f32_s, drop
+   0x41, 0x00, 0xc0, 0x1a,                            // i32.const 0, i32.extend8_s, drop
+   0x0b                                               // end
+]);
+
+let simdFeaturesSupported:boolean|undefined;
+
+// returns the path of the SIMD build of a module (foo.wasm -> foo.simd.wasm) if this engine can run it, otherwise undefined
+function simdPathFor(pathToLoad:string) {
+   if (!pathToLoad.endsWith(".wasm") || pathToLoad.endsWith(".simd.wasm")) return undefined;
+
+   if (simdFeaturesSupported===undefined)
+      simdFeaturesSupported=WebAssembly.validate(simdFeaturesProbe);
+
+   if (!simdFeaturesSupported) return undefined;
+
+   return pathToLoad.slice(0, -".wasm".length)+".simd.wasm";
+}
+
+// a server may answer a request for a missing file with a page (such as index.html) instead of a 404
+function isWasm(bytes:ArrayBuffer) {
+   const magic=new Uint8Array(bytes, 0, Math.min(4, bytes.byteLength));
+   return magic.length==4 && magic[0]==0x00 && magic[1]==0x61 && magic[2]==0x73 && magic[3]==0x6d;
+}
+
+export interface ILoadWasmOpts {
+   simd?:boolean,   // if true, load "foo.simd.wasm" instead of "foo.wasm" when the engine supports it
+}
+
 export class twrWasmBase {
    exports!:WebAssembly.Exports;
    wasmMem!: IWasmMemory;
@@ -25,23 +64,32 @@ export class twrWasmBase {
       }
    }
 
-   async loadWasm(pathToLoad:string, imports:WebAssembly.ModuleImports) {
-      let response;
-      try {
-         response=await fetch(pathToLoad);
-         if (!response.ok) throw new Error("Fetch response error on file '"+pathToLoad+"'\n"+response.statusText);
-      } catch(err:any) {
-         console.log('loadWasm() failed to fetch: '+pathToLoad);
-         throw err;
-      }
-
+   // If opts.simd is set, the engine supports the features twr-simd.a is built with, and there is a "foo.simd.wasm" next to "foo.wasm",
+   // the SIMD version is loaded instead.  Otherwise "foo.wasm" is loaded.
+   async loadWasm(pathToLoad:string, imports:WebAssembly.ModuleImports, opts:ILoadWasmOpts={}) {
       let instance;
-      try {
-         const wasmBytes = await response.arrayBuffer();
-         instance = await WebAssembly.instantiate(wasmBytes, {env: this.getImports(imports)});
-      } catch(err:any) {
-         console.log('Wasm instantiate error: ' + err + (err.stack ? "\n" + err.stack : ''));
-         throw err;
+
+      const simdPath=opts.simd ? simdPathFor(pathToLoad) : undefined;
+      if (simdPath)
+         instance=await this.instantiateSimd(simdPath, imports);
+
+      if (!instance) {
+         let response;
+         try {
+            response=await fetch(pathToLoad);
+            if (!response.ok) throw new Error("Fetch response error on file '"+pathToLoad+"'\n"+response.statusText);
+         } catch(err:any) {
+            console.log('loadWasm() failed to fetch: '+pathToLoad);
+            throw err;
+         }
+
+         try {
+            const wasmBytes = await response.arrayBuffer();
+            instance = await WebAssembly.instantiate(wasmBytes, {env: this.getImports(imports)});
+         } catch(err:any) {
+            console.log('Wasm instantiate error: ' + err + (err.stack ? "\n" + err.stack : ''));
+            throw err;
+         }
       }
 
       if (this.exports) throw new Error ("Unexpected error -- this.exports already set");
@@ -53,12 +101,27 @@ export class twrWasmBase {
 
       const malloc=this.exports.malloc as (size:number)=>number;
       const free=this.exports.free as (size:number)=>number;
-      this.wasmMem=new twrWasmMemory(memory, free, malloc);
+      const heapStats=this.exports.twr_heap_stats_static as (()=>number)|undefined;
+      this.wasmMem=new twrWasmMemory(memory, free, malloc, heapStats);
       this.wasmCall=new twrWasmCall(this.wasmMem, this.exports);
       this.callC=this.wasmCall.callC.bind(this.wasmCall);
    }
 
    
+   // returns undefined if there is no usable SIMD version, in which case the non SIMD version is loaded
+   private async instantiateSimd(simdPath:string, imports:WebAssembly.ModuleImports) {
+      try {
+         const response=await fetch(simdPath);
+         if (!response.ok) return undefined;
+         const wasmBytes=await response.arrayBuffer();
+         if (!isWasm(wasmBytes)) return undefined;
+         return await WebAssembly.instantiate(wasmBytes, {env: this.getImports(imports)});
+      } catch(err:any) {
+         console.log("loadWasm() could not load '"+simdPath+"', so the non SIMD version is used: "+err);
+         return undefined;
+      }
+   }
+
    //see twrWasmModule.constructor - imports - twr_register_callback:this.registerCallback.bind(this), 
    registerCallback(funcNameIdx:number) {
       const funcName=this.wasmMem.getString(funcNameIdx);
@@ -25,9 +25,19 @@ export class twrWasmCall {
    callCImpl(fname:string, cparams:(number|bigint)[]=[]) {
       if (!this.exports[fname]) throw new Error("callC: function '"+fname+"' not in export table.  Use --export wasm-ld flag.");
       const f = this.exports[fname] as Function;
-      let cr=f(...cparams);
+      try {
+         return f(...cparams);
+      }
+      finally {
+         // also flush if the C code trapped (abort, etc.), so output printed before the trap is shown. Linear memory is intact after a trap.
+         this.flushOutput();
+      }
+   }
 
-      return cr;
+   // display any output the C code buffered (printf, etc.) before returning to JavaScript
+   flushOutput() {
+      const flush=this.exports.twr_wasm_flush as Function|undefined;
+      if (flush) flush();
    }
 
    callC(params:[string, ...(string|number|bigint|ArrayBuffer)[]]) {
@@ -20,6 +20,28 @@ export interface IWasmMemoryBase {
    getU32Arr(idx:number): Uint32Array;
 }
 
+// returned by getHeapStats(), see struct twr_heap_stats in twr-crt.h
+// the live, peak, and total fields are zero unless heap profiling has been turned on with twr_heap_profile(true)
+export interface IHeapStats {
+   fragmentation:number;
+   heapSize:number;
+   freeBytes:number;
+   largestFreeRun:number;
+   profiling:boolean;
+   liveBytes:number;
+   peakLiveBytes:number;
+   liveAllocations:number;
+   totalAllocations:number;
+   totalFrees:number;
+   liveBySizeClass:number[];
+   largeSegments:number;
+   largeSpaceBytes:number;
+   largeFreeBytes:number;
+   largeAllocations:number;
+}
+
+const heapStatsSizeClasses=16;  // TWR_HEAP_STATS_SIZE_CLASSES
+
 // IWasmMemory does not support await, and so will only work in a thread that has the module loaded
 // That would be twrWasmModule, twrWasmModuleAsyncProxy
 export interface IWasmMemory extends IWasmMemoryBase {
@@ -28,6 +50,7 @@ export interface IWasmMemory extends IWasmMemoryBase {
    putString(sin:string, codePage?:number):number;
    putU8(u8a:Uint8Array):number;
    putArrayBuffer(ab:ArrayBuffer):number;
+   getHeapStats():IHeapStats;
 }
 
 // IWasmMemoryAsync must be used from an async function since await is needed
@@ -37,6 +60,7 @@ export interface IWasmMemoryAsync extends IWasmMemoryBase {
    putString(sin:string, codePage?:number):Promise<number>;
    putU8(u8a:Uint8Array):Promise<number>;
    putArrayBuffer(ab:ArrayBuffer):Promise<number>;
+   getHeapStats():Promise<IHeapStats>;
 }
 
 /**********************************************************************************************/
@@ -46,21 +70,39 @@ export interface IWasmMemoryAsync extends IWasmMemoryBase {
 
 export class twrWasmMemoryBase implements IWasmMemoryBase {
    memory:WebAssembly.Memory;
-   mem8:Uint8Array;
-   mem16:Uint16Array;
-   mem32:Uint32Array;
-   memF:Float32Array;
-   memD:Float64Array;
+   private _mem8:Uint8Array;
+   private _mem16:Uint16Array;
+   private _mem32:Uint32Array;
+   private _memF:Float32Array;
+   private _memD:Float64Array;
 
    constructor(memory:WebAssembly.Memory) {
       this.memory=memory;
-      this.mem8 = new Uint8Array(memory.buffer);
-      this.mem16 = new Uint16Array(memory.buffer);
-      this.mem32 = new Uint32Array(memory.buffer);
-      this.memF = new Float32Array(memory.buffer);
-      this.memD = new Float64Array(memory.buffer);
+      this._mem8 = new Uint8Array(memory.buffer);
+      this._mem16 = new Uint16Array(memory.buffer);
+      this._mem32 = new Uint32Array(memory.buffer);
+      this._memF = new Float32Array(memory.buffer);
+      this._memD = new Float64Array(memory.buffer);
    }
 
+   // malloc may grow the Wasm memory (memory.grow), which detaches (or, for shared memory, outgrows) the buffer
+   // the views were created on.  So check the buffer size on each access, and recreate the views if it changed.
+   private refreshViews() {
+      if (this._mem8.byteLength!=this.memory.buffer.byteLength) {
+         this._mem8 = new Uint8Array(this.memory.buffer);
+         this._mem16 = new Uint16Array(this.memory.buffer);
+         this._mem32 = new Uint32Array(this.memory.buffer);
+         this._memF = new Float32Array(this.memory.buffer);
+         this._memD = new Float64Array(this.memory.buffer);
+      }
+   }
+
+   get mem8() { this.refreshViews(); return this._mem8; }
+   get mem16() { this.refreshViews(); return this._mem16; }
+   get mem32() { this.refreshViews(); return this._mem32; }
+   get memF() { this.refreshViews(); return this._memF; }
+   get memD() { this.refreshViews(); return this._memD; }
+
    // convert a Javascript string into byte sequence that encodes the string using UTF8, or the requested codePage
    stringToU8(sin:string, codePage=codePageUTF8) {
 
@@ -192,6 +234,31 @@ export class twrWasmMemoryBase implements IWasmMemoryBase {
       return u8;
    }
 
+   // read a struct twr_heap_stats
+   protected readHeapStats(idx:number):IHeapStats {
+      const liveBySizeClass:number[]=[];
+      for (let i=0; i<heapStatsSizeClasses; i++)
+         liveBySizeClass.push(this.getLong(idx+44+i*4));
+
+      return {
+         fragmentation: this.getDouble(idx),
+         heapSize: this.getLong(idx+8),
+         freeBytes: this.getLong(idx+12),
+         largestFreeRun: this.getLong(idx+16),
+         profiling: this.getLong(idx+20)!=0,
+         liveBytes: this.getLong(idx+24),
+         peakLiveBytes: this.getLong(idx+28),
+         liveAllocations: this.getLong(idx+32),
+         totalAllocations: this.getLong(idx+36),
+         totalFrees: this.getLong(idx+40),
+         liveBySizeClass: liveBySizeClass,
+         largeSegments: this.getLong(idx+108),
+         largeSpaceBytes: this.getLong(idx+112),
+         largeFreeBytes: this.getLong(idx+116),
+         largeAllocations: this.getLong(idx+120)
+      };
+   }
+
    // get a int32 array out of module memory when passed in index to [size, dataptr]
    getU32Arr(idx:number): Uint32Array {
       if (idx<0 || idx>= this.mem8.length) throw new Error("invalid index passed to getU32: "+idx);
@@ -218,11 +285,20 @@ export class twrWasmMemoryBase implements IWasmMemoryBase {
 export class twrWasmMemory extends twrWasmMemoryBase implements IWasmMemory {
    malloc:(size:number)=>number;
    free:(size:number)=>void;
+   heapStats?:()=>number;
 
-   constructor(memory:WebAssembly.Memory, free:(size:number)=>void, malloc:(size:number)=>number) {
+   constructor(memory:WebAssembly.Memory, free:(size:number)=>void, malloc:(size:number)=>number, heapStats?:()=>number) {
       super(memory);
       this.free=free;
       this.malloc=malloc;
+      this.heapStats=heapStats;
+   }
+
+   // get the malloc heap statistics.  To also get the live allocation counts, call twr_heap_profile(true) first
+   getHeapStats() {
+      if (!this.heapStats) throw new Error("getHeapStats: twr_heap_stats_static is not exported by this module");
+      // the stats are read from a static struct, since allocating one here would be counted in the stats
+      return this.readHeapStats(this.heapStats());
    }
 
    // allocate and copy a string into the webassembly module memory as utf8 (or the specified codePage)
@@ -256,15 +332,25 @@ export class twrWasmMemory extends twrWasmMemoryBase implements IWasmMemory {
 export class twrWasmMemoryAsync extends twrWasmMemoryBase implements IWasmMemoryAsync {
    malloc:(size:number)=>Promise<number>;
    free:(size:number)=>Promise<void>;
+   heapStats:()=>Promise<number>;
 
    constructor(memory:WebAssembly.Memory, mallocImpl:(size:number)=>Promise<number>, callCImpl:(funcName:string, any:[...any])=>Promise<any>) {
       super(memory);
       this.free = (size:number) => {
          return callCImpl("free", [size]) as Promise<void>;
       }
+      this.heapStats = () => {
+         return callCImpl("twr_heap_stats_static", []) as Promise<number>;
+      }
       this.malloc = mallocImpl;
    }
 
+   // get the malloc heap statistics.  To also get the live allocation counts, call twr_heap_profile(true) first
+   async getHeapStats() {
+      // the stats are read from a static struct, since allocating one here would be counted in the stats
+      return this.readHeapStats(await this.heapStats());
+   }
+
    // allocate and copy a string into the webassembly module memory as utf8 (or the specified codePage)
    async putString(sin:string, codePage=codePageUTF8) {
       const ru8=this.stringToU8(sin, codePage);